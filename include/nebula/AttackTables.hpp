@@ -1,23 +1,94 @@
 #ifndef NEBULA_ATTACKTABLES_HPP
 #define NEBULA_ATTACKTABLES_HPP
 
+#include "nebula/Board.hpp"
+
 #include <array>
 #include <cstdint>
 
 namespace nebula
 {
 
+// one square's entry for magic bitboard lookup
+struct Magic
+{
+    uint64_t mask; // relevant occupancy (edges excluded)
+    uint64_t magic;
+    uint64_t* attacks; // points into the shared attack table
+    unsigned shift;
+
+    inline unsigned index(uint64_t occ) const { return static_cast<unsigned>(((occ & mask) * magic) >> shift); }
+};
+
 struct AttackTables
 {
     static std::array<uint64_t, 64> knight;
     static std::array<uint64_t, 64> king;
     static std::array<std::array<uint64_t, 64>, 2> pawn;
 
+    static std::array<Magic, 64> rook_magics;
+    static std::array<Magic, 64> bishop_magics;
+
+    // sum over all squares of 2^(relevant bits)
+    static std::array<uint64_t, 0x19000> rook_table;
+    static std::array<uint64_t, 0x1480> bishop_table;
+
+    // squares strictly between two aligned squares, else empty
+    static std::array<std::array<uint64_t, 64>, 64> between;
+
+    // full board line through two aligned squares, else empty
+    static std::array<std::array<uint64_t, 64>, 64> line;
+
+    // the files on either side of a file
+    static std::array<uint64_t, 8> adjacent_files;
+
+    // squares an enemy pawn must not occupy for a pawn on sq to be passed
+    static std::array<std::array<uint64_t, 64>, 2> passed_mask;
+
+    static constexpr uint64_t file_a = 0x0101010101010101ULL;
+    static constexpr uint64_t file_h = file_a << 7;
+
     static constexpr std::array<std::pair<int, int>, 4> rook_dirs = { { { 0,  1 }, { 0, -1 }, { 1,  0 }, { -1,  0 } } };
     static constexpr std::array<std::pair<int, int>, 4> bishop_dirs = { { { 1,  1 }, { -1,  1 }, { -1, -1 }, { 1, -1 } } };
     static constexpr std::array<std::pair<int, int>, 8> queen_dirs = { { { 0,  1 }, { 0, -1 }, { 1,  0 }, { -1,  0 }, { 1,  1 }, { -1,  1 }, { -1, -1 }, { 1, -1 } } };
+
+    // attacked squares of a non-pawn piece on sq given the occupancy
+    template<PieceType pt>
+    static inline uint64_t attacks(int sq, uint64_t occ)
+    {
+        static_assert(pt != PieceType::Pawn, "pawn attacks depend on color; use AttackTables::pawn");
+
+        if constexpr(pt == PieceType::Knight)
+            return knight[sq];
+        else if constexpr(pt == PieceType::King)
+            return king[sq];
+        else if constexpr(pt == PieceType::Bishop)
+            return bishop_magics[sq].attacks[bishop_magics[sq].index(occ)];
+        else if constexpr(pt == PieceType::Rook)
+            return rook_magics[sq].attacks[rook_magics[sq].index(occ)];
+        else
+            return attacks<PieceType::Rook>(sq, occ) | attacks<PieceType::Bishop>(sq, occ);
+    }
+
+    // set-wise helpers for pawn structure; each works on every pawn in b at once
+    static inline uint64_t shift_east(uint64_t b) { return (b & ~file_h) << 1; }
+    static inline uint64_t shift_west(uint64_t b) { return (b & ~file_a) >> 1; }
+    static inline uint64_t adjacent(uint64_t b) { return shift_east(b) | shift_west(b); }
+
+    // b plus every square above (north) or below (south) it
+    static inline uint64_t north_fill(uint64_t b) { b |= b << 8; b |= b << 16; return b | (b << 32); }
+    static inline uint64_t south_fill(uint64_t b) { b |= b >> 8; b |= b >> 16; return b | (b >> 32); }
+
+    // whole files holding any square of b
+    static inline uint64_t file_fill(uint64_t b) { return north_fill(b) | south_fill(b); }
+
+    // squares strictly ahead of b from c's point of view
+    static inline uint64_t front_span(Color c, uint64_t b) { return c == Color::White ? north_fill(b) << 8 : south_fill(b) >> 8; }
+
+    // squares attacked by pawns of color c
+    static inline uint64_t pawn_attacks(Color c, uint64_t b) { return c == Color::White ? adjacent(b) << 8 : adjacent(b) >> 8; }
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -1,6 +1,9 @@
 #ifndef NEBULA_BOARD_HPP
 #define NEBULA_BOARD_HPP
 
+#include "nebula/NNUE.hpp"
+#include "nebula/Score.hpp"
+
 #include <array>
 #include <cstdint>
 #include <string>
@@ -34,12 +37,59 @@ struct Move
 
     std::string uci() const;
 
+    // from | to << 6 | promo << 12; the rest is recovered by Board::decode_move
+    inline uint16_t encode() const { return static_cast<uint16_t>(from | (to << 6) | ((promo == 0xFF ? 0 : promo) << 12)); }
+
     bool operator==(const Move& other) const;
 };
 
+// fixed-capacity move container that lives on the stack, with an ordering score per move
+class MoveList
+{
+public:
+    // no legal chess position has more than 218 moves
+    static constexpr int capacity = 256;
+
+    MoveList(): count(0) {}
+
+    inline void push_back(const Move& m) { moves[count++] = m; }
+    inline void clear() { count = 0; }
+
+    inline int size() const { return count; }
+    inline bool empty() const { return count == 0; }
+
+    inline Move& operator[](int i) { return moves[i]; }
+    inline const Move& operator[](int i) const { return moves[i]; }
+
+    // ordering scores, stored alongside the moves
+    inline int& score(int i) { return scores[i]; }
+    inline int score(int i) const { return scores[i]; }
+
+    // stable sort by descending score
+    void sort();
+
+    inline Move* begin() { return moves; }
+    inline Move* end() { return moves + count; }
+    inline const Move* begin() const { return moves; }
+    inline const Move* end() const { return moves + count; }
+
+private:
+    // intentionally left uninitialized; only [0, count) is ever read
+    Move moves[capacity];
+    int scores[capacity];
+    int count;
+};
+
 enum class Color : int { White = 0, Black };
 enum class PieceType : int { Pawn = 0, Knight, Bishop, Rook, Queen, King };
 
+// evaluation terms the board keeps up to date as pieces come and go
+struct EvalState
+{
+    Score psq; // material plus PST, white minus black
+    int phase = 0; // Values::phase_weight summed over both sides
+};
+
 class Board
 {
 public:
@@ -81,13 +131,25 @@ public:
     inline bool is_fifty_move_rule() const { return half_moves >= 100; }
 
     // getting peudo-legal moves
-    std::vector<Move> generate_pseudo() const;
+    MoveList generate_pseudo() const;
+
+    // getting legal moves
+    MoveList generate_moves() const;
+
+    // staged legal generation; all but generate_evasions expect the side to move not to be in check
+    MoveList generate_captures() const; // captures and promotions
+    MoveList generate_quiets() const; // everything else, including castling
+    MoveList generate_quiet_checks() const; // quiet moves that give check
+    MoveList generate_evasions() const; // every legal move while in check
 
-    // getting moves
-    std::vector<Move> generate_moves();
+    // does a legal move give check, without making it
+    bool gives_check(const Move& move) const;
 
-    // legality check
-    bool is_legal(const Move& move);
+    // is an arbitrary move (e.g. from the transposition table) pseudo-legal here
+    bool is_pseudo_legal(const Move& move) const;
+
+    // legality check for a pseudo-legal move
+    bool is_legal(const Move& move) const;
 
     // get a bitboard
     inline uint64_t pieces(Color c, PieceType pt) const { return pieces_bb[as_int(c)][as_int(pt)]; }
@@ -112,6 +174,9 @@ public:
     // helper
     bool is_attacked(int sq, Color by) const;
 
+    // pieces of either color attacking sq given the occupancy
+    uint64_t attackers_to(int sq, uint64_t occ) const;
+
     // is in check
     bool in_check() const;
 
@@ -122,11 +187,23 @@ public:
     // for Zobrist hashing
     inline uint64_t key() const { return zobrist_key; }
 
+    // running material, PST and phase totals
+    inline const EvalState& eval_state() const { return eval_terms; }
+
+    // Zobrist key of the pawns alone, for the pawn hash
+    inline uint64_t pawn_key() const { return pawn_zobrist_key; }
+
+    // network accumulator for this position, brought up to date from the nearest computed ply
+    const NNUE::Accumulator& accumulator() const;
+
     // print the board
     void print(std::ostream& os = std::cout) const;
 
     Move from_uci(const std::string& uci) const;
 
+    // rebuild a Move::encode()d move against this position; only meaningful if it is pseudo-legal here
+    Move decode_move(uint16_t code) const;
+
 private:
     // for unmaking moves
     struct Undo
@@ -138,6 +215,8 @@ private:
         int prev_half_moves;
         int prev_full_move;
         uint64_t prev_zobrist_key;
+        uint64_t prev_pawn_zobrist_key;
+        EvalState prev_eval_terms;
     };
 
     // for unmaking null moves
@@ -157,6 +236,17 @@ private:
     // history of null moves
     std::vector<NullUndo> null_history;
 
+    // accumulator for each ply (index = history.size()), computed lazily by accumulator()
+    struct NNUEState
+    {
+        NNUE::Accumulator acc;
+        NNUE::Delta delta;
+        bool computed[2] = { false, false };
+    };
+
+    // only kept while a network is loaded; mutable since evaluation fills it in
+    mutable std::vector<NNUEState> nnue_states;
+
     // bitboards
     std::array<std::array<uint64_t, num_piece_types>, num_colors> pieces_bb;
     std::array<uint64_t, num_colors> color_bb;
@@ -174,9 +264,17 @@ private:
     
     // for Zobrist hashing
     uint64_t zobrist_key;
+    uint64_t pawn_zobrist_key;
+
+    // updated by set_piece and remove_piece
+    EvalState eval_terms;
+
+    // add (sign = 1) or take away (sign = -1) a piece's share of eval_terms
+    void update_eval_terms(int sq, int c, int pt, int sign);
 
     static constexpr uint64_t rank_2 = 0xFFULL << 8;
     static constexpr uint64_t rank_7 = 0xFFULL << 48;
+    static constexpr uint64_t promo_ranks = 0xFFULL | (0xFFULL << 56);
     static constexpr uint64_t file_a = 0x0101010101010101ULL;
     static constexpr uint64_t file_h = 0x8080808080808080ULL;
 
@@ -190,15 +288,39 @@ private:
     static uint64_t zobrist_black_to_move;
 
     // Zobrist updates
-    inline void update_zobrist_piece(int sq, Color c, PieceType pt) { zobrist_key ^= zobrist_piece[as_int(c)][as_int(pt)][sq]; }
+    inline void update_zobrist_piece(int sq, Color c, PieceType pt)
+    {
+        zobrist_key ^= zobrist_piece[as_int(c)][as_int(pt)][sq];
+
+        if(pt == PieceType::Pawn)
+            pawn_zobrist_key ^= zobrist_piece[as_int(c)][as_int(pt)][sq];
+    }
     inline void update_zobrist_side() { zobrist_key ^= zobrist_black_to_move; }
     inline void update_zobrist_castling(int oldR, int newR) { zobrist_key ^= zobrist_castling[oldR]; zobrist_key ^= zobrist_castling[newR]; }
     inline void update_zobrist_enpassant(int oldSq, int newSq) { if(oldSq >= 0) zobrist_key ^= zobrist_en_passant_file[oldSq & 7]; if(newSq >= 0) zobrist_key ^= zobrist_en_passant_file[newSq & 7]; }
 
-    // move generation organization
-    void generate_pawn_moves(std::vector<Move>& moves) const;
-    void generate_knight_moves(std::vector<Move>& moves) const;
-    void generate_king_moves(std::vector<Move>& moves) const;
+    // categories for staged move generation
+    enum class GenType { Captures, Quiets, Evasions, NonEvasions };
+
+    // legal move generation for one category
+    template<GenType gt>
+    void generate(MoveList& moves) const;
+
+    // pieces of the side to move pinned to their king
+    uint64_t pinned_pieces() const;
+
+    // move generation organization; destinations are limited to target (pawns: check mask), pinned pieces stay on their pin line
+    void generate_pawn_moves(MoveList& moves, uint64_t mask, uint64_t pinned, bool noisy, bool quiet) const;
+    void generate_knight_moves(MoveList& moves, uint64_t target, uint64_t pinned) const;
+    template<PieceType pt>
+    void generate_slider_moves(MoveList& moves, uint64_t target, uint64_t pinned) const;
+
+    // quiet moves of one piece type onto checks (its checking squares), or, for a piece in
+    // discoverers, anywhere off its line to the enemy king on eksq
+    template<PieceType pt>
+    void generate_checking_moves(MoveList& moves, uint64_t checks, uint64_t discoverers, int eksq, uint64_t pinned) const;
+    void generate_king_moves(MoveList& moves, uint64_t target, bool legal) const;
+    void generate_castling(MoveList& moves) const;
 
     // returns -1 if invalid char, otherwise returns 0 and modifies out_c and out_pt
     int piece_char_to_code(char c, Color& out_c, PieceType& out_pt) const;
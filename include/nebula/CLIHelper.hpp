@@ -1,16 +1,55 @@
 #ifndef NEBULA_CLIHELPER_HPP
 #define NEBULA_CLIHELPER_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+
 namespace nebula
 {
 
 enum class ReturnCode { Good, Help, Error };
 
-enum class InputMode { PlayerInput, Auto };
+enum class InputMode { PlayerInput, Auto, Perft, Bench };
+
+enum class EvalMode { Classical, NNUE };
+
+struct Options
+{
+    InputMode mode = InputMode::Auto;
+    int depth = 0; // 0 = default for the mode
+    int length = std::numeric_limits<int>::max();
+    std::string fen; // empty = starting position
+    int threads = 1;
+    size_t hash_mb = 16;
+    std::string hash_file; // empty = keep the hash in memory only
+
+    // evaluation
+    EvalMode eval = EvalMode::Classical;
+    std::string nnue_file = "nebula.nnue";
+    std::string params_file; // empty = built-in weights
+
+    // search limits in ms (0 = none)
+    int64_t movetime = 0;
+    int64_t wtime = 0;
+    int64_t btime = 0;
+    int64_t winc = 0;
+    int64_t binc = 0;
+    uint64_t nodes = 0;
+
+    // perft
+    bool divide = false;
+    size_t perft_hash_mb = 0;
+    std::string epd;
+
+    // bench
+    uint64_t baseline_nps = 0; // 0 = nothing to compare against
+};
 
-// modifies references only if valid input, in which case ReturnCode is Good
-ReturnCode opts(int argc, char* argv[], InputMode& mode, int& depth, int& length);
+// modifies options only if valid input, in which case ReturnCode is Good
+ReturnCode opts(int argc, char* argv[], Options& options);
 
 }
 
-#endif
\ No newline at end of file
+#endif
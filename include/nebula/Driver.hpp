@@ -2,15 +2,22 @@
 #define NEBULA_DRIVER_HPP
 
 #include "nebula/Board.hpp"
+#include "nebula/Search.hpp"
+
+#include <string>
 
 namespace nebula
 {
 
 // player vs. engine
-void pve(Board& board, int depth, int max_moves);
+void pve(Board& board, int depth, int max_moves, int threads = 1, SearchLimits limits = SearchLimits{}, size_t hash_mb = TranspositionTable::default_mb, const std::string& hash_file = "");
 
 // engine vs. engine
-void eve(Board& board, int depth, int max_moves);
+void eve(Board& board, int depth, int max_moves, int threads = 1, SearchLimits limits = SearchLimits{}, size_t hash_mb = TranspositionTable::default_mb, const std::string& hash_file = "");
+
+// fixed-depth search of a built-in position set; prints nodes and NPS, and the change against
+// baseline_nps (another build's NPS) if one is given
+void bench(int depth, int threads = 1, size_t hash_mb = TranspositionTable::default_mb, uint64_t baseline_nps = 0);
 
 }
 
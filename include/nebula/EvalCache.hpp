@@ -0,0 +1,58 @@
+#ifndef NEBULA_EVALCACHE_HPP
+#define NEBULA_EVALCACHE_HPP
+
+#include "nebula/LargeMemory.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace nebula
+{
+
+// static evals by Zobrist key, shared by all search threads; each entry is a single
+// atomic word (upper 48 key bits | 16-bit eval), so a racing write can't be read torn
+class EvalCache
+{
+public:
+    static constexpr size_t default_entries = 1 << 17;
+
+    // entries is rounded down to a power of two
+    explicit EvalCache(size_t entries = default_entries);
+
+    // returns true and sets eval if key is cached
+    inline bool probe(uint64_t key, int& eval) const
+    {
+        uint64_t e = table[key & mask].load(std::memory_order_relaxed);
+
+        if(((e ^ key) & key_bits) != 0)
+            return false;
+
+        eval = static_cast<int16_t>(e & 0xFFFF);
+
+        return true;
+    }
+
+    // evals outside the int16_t range are not cached
+    inline void store(uint64_t key, int eval)
+    {
+        if(eval < INT16_MIN || eval > INT16_MAX)
+            return;
+
+        table[key & mask].store((key & key_bits) | static_cast<uint16_t>(eval), std::memory_order_relaxed);
+    }
+
+    // not while searching
+    void clear();
+
+private:
+    static constexpr uint64_t key_bits = ~0xFFFFULL;
+
+    LargeMemory memory;
+    std::atomic<uint64_t>* table;
+    size_t mask;
+};
+
+}
+
+#endif
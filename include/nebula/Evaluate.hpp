@@ -2,6 +2,8 @@
 #define EVALUATE_HPP
 
 #include "Board.hpp"
+#include "PawnHash.hpp"
+#include "Values.hpp"
 
 namespace nebula
 {
@@ -12,51 +14,49 @@ public:
     // static evaluation
     static int evaluate(const Board& board);
 
+    // lazy evaluation: if the cheap terms already put the score at or below alpha, or at or above
+    // beta, by more than the pawn structure could change it, returns a bound on that side of the
+    // window without the pawn terms; exact (if given) tells whether the result is the full eval
+    static int evaluate(const Board& board, int alpha, int beta, bool* exact = nullptr);
+
+    // single-square passed pawn test, one mask lookup
+    static bool is_passed_pawn(const Board& board, Color color, int square);
+
+    // empty the calling thread's pawn hash
+    static void clear_pawn_hash();
+
 private:
-    static constexpr int phase_weight[6] =
-    {
-        0, // pawn
-        1, // knight
-        1, // bishop
-        2, // rook
-        4, // queen
-        0  // king
-    };
-    static constexpr int max_phase = (phase_weight[1] * 2 + phase_weight[2] * 2 + phase_weight[3] * 2 + phase_weight[4] * 1) * 2;
-    
-    // returns a value in [0, 1]: 1 = full opening, 0 = full endgame
-    static inline double phase_of_game(const Board& board)
+    // returns a value in [0, Values::max_phase]: max = full opening, 0 = full endgame
+    static inline int phase_of_game(const Board& board)
     {
-        int phase = 0;
+        // kept up to date by the board; promotions can push it past the maximum
+        int phase = board.eval_state().phase;
 
-        // subtract phase-weight for each piece off the board
-        for(int pt = 1; pt <= 4; ++pt)
-        {
-            // count white + black
-            int count = __builtin_popcountll(board.pieces(Color::White,  static_cast<PieceType>(pt))) + __builtin_popcountll(board.pieces(Color::Black,  static_cast<PieceType>(pt)));
-            phase += (phase_weight[pt] * count);
-        }
+        return phase < 0 ? 0 : (phase > Values::max_phase ? Values::max_phase : phase);
+    }
 
-        // clamp and normalize
-        if(phase < 0)
-            phase = 0;
+    // static evaluation helpers, white minus black
+    static Score castling_bonus(const Board& board);
+    static Score pawn_structure(const Board& board);
 
-        return static_cast<double>(phase) / max_phase;
-    }
+    // most the pawn structure could add for white (up) or for black (down), from the pawn entry
+    static void pawn_structure_bounds(const Board& board, int phase, int& up, int& down);
 
-    // static evaluation helpers
-    static int material(const Board& board, double phase);
-    static int castling_bonus(const Board& board, double phase);
-    static int pawn_structure(const Board& board, double phase);
-
-    // helpers for pawn structure
-    static int analyze_pawn_weaknesses(const Board& board, Color color, double phase);
-    static int analyze_passed_pawns(const Board& board, Color color, double phase);
-    static bool is_isolated_pawn(const Board& board, Color color, int file);
-    static bool is_doubled_pawn(const Board& board, Color color, int file);
-    static bool is_backward_pawn(const Board& board, Color color, int square);
-    static bool is_passed_pawn(const Board& board, Color color, int square);
-    static int passed_pawn_value(int rank, double phase);
+    // highest and lowest pawn structure score the pawn counts and passers allow, white minus black
+    static void pawn_score_range(const Board& board, const uint64_t passed[2], Score& most, Score& least);
+
+    // the calling thread's pawn hash
+    static PawnHash& pawn_hash();
+
+    // pawn hash lookup, filling the entry on a miss
+    static const PawnEntry& probe_pawns(const Board& board);
+
+    // helpers for pawn structure, set-wise over all pawns of a color; passed is passed_pawns by color
+    static Score evaluate_pawns(const Board& board, const uint64_t passed[2]);
+    static uint64_t passed_pawns(const Board& board, Color color);
+    static Score analyze_pawn_weaknesses(const Board& board, Color color);
+    static Score analyze_passed_pawns(const Board& board, Color color, uint64_t passed);
+    static Score passed_pawn_value(int rank);
 };
 
 }
@@ -0,0 +1,63 @@
+#ifndef NEBULA_LARGEMEMORY_HPP
+#define NEBULA_LARGEMEMORY_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace nebula
+{
+
+// zero-filled, cache-line aligned block for big hash tables; blocks of 2 MB or more go on huge
+// pages where the OS allows
+class LargeMemory
+{
+public:
+    enum class Pages
+    {
+        Huge, // explicit huge pages (MAP_HUGETLB)
+        Transparent, // normal mapping advised to use transparent huge pages
+        Normal, // plain pages, or the aligned heap for small blocks
+        File // a mapped file
+    };
+
+    LargeMemory() = default;
+    explicit LargeMemory(size_t bytes);
+    ~LargeMemory();
+
+    LargeMemory(const LargeMemory&) = delete;
+    LargeMemory& operator=(const LargeMemory&) = delete;
+
+    LargeMemory(LargeMemory&& other) noexcept;
+    LargeMemory& operator=(LargeMemory&& other) noexcept;
+
+    // map path, creating it or growing it with zeros to at least bytes; with shared, writes go
+    // through to the file, otherwise they stay private; empty (data() == nullptr) on failure
+    static LargeMemory map_file(const std::string& path, size_t bytes, bool shared);
+
+    // size of the file at path, 0 if it can't be read
+    static size_t file_size(const std::string& path);
+
+    // flush a shared file mapping to disk
+    bool sync() const;
+
+    inline void* data() const { return ptr; }
+    inline size_t size() const { return bytes; }
+    inline Pages pages() const { return page_kind; }
+
+    // e.g. "64 MB, 2 MB transparent huge pages"
+    std::string describe() const;
+
+private:
+    static constexpr size_t huge_page_size = 2 * 1024 * 1024;
+
+    void* ptr = nullptr;
+    size_t bytes = 0;
+    size_t mapped = 0; // length to unmap; 0 if the heap fallback was used
+    Pages page_kind = Pages::Normal;
+
+    void release();
+};
+
+}
+
+#endif
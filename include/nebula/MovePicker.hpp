@@ -0,0 +1,61 @@
+#ifndef NEBULA_MOVEPICKER_HPP
+#define NEBULA_MOVEPICKER_HPP
+
+#include "nebula/Board.hpp"
+
+#include <array>
+
+namespace nebula
+{
+
+class SearchWorker;
+
+// hands out moves one at a time, generating and ordering only as far as the search gets
+class MovePicker
+{
+public:
+    // main search: TT move, captures, killers, then quiets by history
+    MovePicker(const Board& board, const SearchWorker& search, const Move* tt_move, const std::array<Move, 2>* killers);
+
+    // quiescence: captures, then quiet checks (all evasions when in check)
+    MovePicker(const Board& board, const SearchWorker& search);
+
+    // returns false once every move has been yielded
+    bool next(Move& out);
+
+private:
+    enum class Stage
+    {
+        TTMove, GenCaptures, Captures, Killers, GenQuiets, Quiets,
+        GenEvasions, Evasions,
+        QGenCaptures, QCaptures, QGenChecks, QChecks,
+        Done
+    };
+
+    const Board& board;
+    const SearchWorker& search;
+
+    Stage stage;
+    Move tt_move;
+    bool has_tt_move;
+    std::array<Move, 2> killers;
+    int killer_index;
+
+    MoveList moves;
+    int current;
+
+    // scoring for each stage
+    void score_captures();
+    void score_quiets();
+    void score_evasions();
+
+    // move the best remaining move to the current slot
+    const Move& select_best();
+
+    // already handed out by an earlier stage
+    bool is_special(const Move& m) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef NEBULA_NNUE_HPP
+#define NEBULA_NNUE_HPP
+
+#include <cstdint>
+#include <string>
+
+// AVX2 and SSSE3 paths for the network, picked at load time from what the CPU supports;
+// build with -DNEBULA_NNUE_SIMD=0 to force the scalar code
+#ifndef NEBULA_NNUE_SIMD
+#define NEBULA_NNUE_SIMD 1
+#endif
+
+namespace nebula
+{
+
+class Board;
+
+// efficiently updatable network: (HalfKP 40960 -> 256) x 2 -> 1
+//
+// each side's half of the first layer sees every non-king piece relative to its own king,
+// so a move only touches a few weight rows unless that side's king moves; the output layer
+// reads both halves, side to move first, through a clipped ReLU
+class NNUE
+{
+public:
+    static constexpr int hidden = 256;
+
+    // own king square x (relative color, piece type without kings) x square
+    static constexpr int inputs = 64 * 10 * 64;
+
+    // quantisation: first layer activations are clipped to [0, 127], output weights are scaled by 64
+    static constexpr int activation_max = 127;
+    static constexpr int weight_scale = 64;
+
+    // centipawns per unit of the float network's output
+    static constexpr int output_scale = 400;
+
+    // evaluations are clamped to +-max_eval
+    static constexpr int max_eval = 30000;
+
+    // first layer sums for both perspectives (index = Color)
+    struct alignas(64) Accumulator
+    {
+        int16_t values[2][hidden];
+    };
+
+    // piece changes made by one move, recorded as Board::set_piece/remove_piece run
+    struct Delta
+    {
+        static constexpr int capacity = 4; // castling moves king and rook
+
+        int count = -1; // -1 = unknown, the accumulator has to be rebuilt from scratch
+
+        struct Change
+        {
+            int8_t sq, color, piece, sign;
+        } changes[capacity];
+    };
+
+    // loads a network file ("NEBULANN" header, then the quantised weights); on success
+    // Evaluate::evaluate uses the network from then on
+    static bool load(const std::string& path);
+
+    static inline bool enabled() { return active; }
+
+    // inference kernels chosen by load: "avx2", "ssse3" or "scalar"
+    static const char* simd();
+
+    // score from the side to move's point of view; brings the board's accumulator up to date
+    static int evaluate(const Board& board);
+
+    // rebuild one perspective from every piece on the board
+    static void refresh(const Board& board, int perspective, Accumulator& acc);
+
+    // acc = prev plus the changes in delta for one perspective; king_sq is that side's king
+    static void update(const Accumulator& prev, const Delta& delta, int perspective, int king_sq, Accumulator& acc);
+
+private:
+    static bool active;
+
+    // index of a non-king piece in one perspective's half
+    static inline int feature(int perspective, int king_sq, int sq, int color, int piece)
+    {
+        // black sees the board flipped, so both halves share one weight set
+        if(perspective == 1)
+        {
+            king_sq ^= 56;
+            sq ^= 56;
+        }
+
+        int relative = color == perspective ? 0 : 1;
+
+        return (king_sq * 10 + relative * 5 + piece) * 64 + sq;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef NEBULA_PAWNHASH_HPP
+#define NEBULA_PAWNHASH_HPP
+
+#include "nebula/LargeMemory.hpp"
+#include "nebula/Score.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nebula
+{
+
+// pawn structure results for one pawn configuration
+struct PawnEntry
+{
+    // upper half of Board::pawn_key; an empty slot (all zero) is also the correct entry for no pawns
+    uint32_t check;
+    Score score; // white minus black
+    Score most, least; // range of score the lazy eval may assume before it is computed
+    uint64_t passed[2]; // passed pawns by color
+};
+
+static_assert(sizeof(PawnEntry) == 32, "two pawn entries per cache line");
+
+// direct-mapped cache of pawn structure; pawns rarely move, so nearly every probe hits
+class PawnHash
+{
+public:
+    static constexpr size_t default_entries = 1 << 14;
+
+    // entries is rounded down to a power of two
+    explicit PawnHash(size_t entries = default_entries);
+
+    // the slot for key; it holds key only if entry.check matches the upper half of key
+    inline PawnEntry& entry(uint64_t key) { return table[key & mask]; }
+
+    void clear();
+
+private:
+    LargeMemory memory;
+    PawnEntry* table;
+    size_t mask;
+};
+
+}
+
+#endif
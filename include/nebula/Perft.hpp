@@ -0,0 +1,55 @@
+#ifndef NEBULA_PERFT_HPP
+#define NEBULA_PERFT_HPP
+
+#include "nebula/Board.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nebula
+{
+
+// counts the leaves of the legal move tree, for verifying and timing move generation
+class Perft
+{
+public:
+    // hash_mb = 0 disables the perft hash
+    Perft(int threads = 1, size_t hash_mb = 0);
+
+    // total leaf count, root moves split across threads
+    uint64_t run(const Board& board, int depth);
+
+    // leaf count below each root move
+    std::vector<std::pair<Move, uint64_t>> divide(const Board& board, int depth);
+
+private:
+    // lockless entry: key is stored XOR data so torn writes read as misses
+    struct HashEntry
+    {
+        std::atomic<uint64_t> key_xor_data{0};
+        std::atomic<uint64_t> data{0}; // nodes << 8 | depth
+    };
+
+    int threads;
+    std::vector<HashEntry> hash;
+
+    // recursive count with bulk counting at depth 1
+    uint64_t count(Board& board, int depth);
+
+    // the slot is picked from key and depth together; depth is checked again on a hit
+    bool probe(uint64_t key, int depth, uint64_t& nodes) const;
+    void store(uint64_t key, int depth, uint64_t nodes);
+};
+
+// print perft (or divide) for one position with timing
+void perft(const Board& board, int depth, bool divide, int threads, size_t hash_mb);
+
+// run an EPD suite ("FEN ;D1 20 ;D2 400 ..."); returns the number of failed checks
+int perft_suite(const std::string& path, int max_depth, int threads, size_t hash_mb);
+
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef NEBULA_SCORE_HPP
+#define NEBULA_SCORE_HPP
+
+#include <cstdint>
+
+namespace nebula
+{
+
+// midgame and endgame values packed into one int, so a term costs a single add
+// (endgame in the upper 16 bits, midgame in the lower; both must fit an int16_t)
+class Score
+{
+public:
+    constexpr Score(): value(0) {}
+    constexpr Score(int mg, int eg): value(static_cast<int>(static_cast<unsigned>(eg) << 16) + mg) {}
+
+    constexpr int mg() const { return static_cast<int16_t>(static_cast<uint16_t>(static_cast<unsigned>(value))); }
+
+    // the midgame half borrows from the endgame half when negative; + 0x8000 rounds that back
+    constexpr int eg() const { return static_cast<int16_t>(static_cast<uint16_t>(static_cast<unsigned>(value + 0x8000) >> 16)); }
+
+    // phase runs from 0 (bare kings and pawns) to max_phase (all pieces on the board)
+    constexpr int blend(int phase, int max_phase) const { return (mg() * phase + eg() * (max_phase - phase)) / max_phase; }
+
+    constexpr Score operator+(Score other) const { return raw(value + other.value); }
+    constexpr Score operator-(Score other) const { return raw(value - other.value); }
+    constexpr Score operator-() const { return raw(-value); }
+    constexpr Score operator*(int n) const { return raw(value * n); }
+
+    constexpr Score& operator+=(Score other) { value += other.value; return *this; }
+    constexpr Score& operator-=(Score other) { value -= other.value; return *this; }
+
+    constexpr bool operator==(Score other) const { return value == other.value; }
+    constexpr bool operator!=(Score other) const { return value != other.value; }
+
+private:
+    int value;
+
+    static constexpr Score raw(int v)
+    {
+        Score s;
+        s.value = v;
+        return s;
+    }
+};
+
+}
+
+#endif
@@ -2,34 +2,150 @@
 #define NEBULA_SEARCH_HPP
 
 #include "nebula/Board.hpp"
+#include "nebula/EvalCache.hpp"
 #include "nebula/TranspositionTable.hpp"
 #include "nebula/Values.hpp"
 
+#include "nebula/ThreadPool.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <limits>
+#include <memory>
+#include <vector>
+
+// search statistics; build with -DNEBULA_STATS=0 to take the counters out of the hot path
+#ifndef NEBULA_STATS
+#define NEBULA_STATS 1
+#endif
+
+#if NEBULA_STATS
+#define NEBULA_STAT(x) (x)
+#else
+#define NEBULA_STAT(x) ((void)0)
+#endif
 
 namespace nebula
 {
 
-class Search
+class Search;
+
+// limits for one best_move call; 0 means no limit
+struct SearchLimits
+{
+    int64_t movetime = 0; // ms for this move
+    int64_t time[2] = { 0, 0 }; // remaining clock ms, indexed by Color
+    int64_t inc[2] = { 0, 0 }; // increment ms per move, indexed by Color
+    uint64_t nodes = 0; // node budget across all threads
+};
+
+// counters for one best_move call, summed over all threads
+struct SearchStats
+{
+    static constexpr bool enabled = NEBULA_STATS;
+
+    // beta cutoffs by index of the move that caused them; the last bucket takes the rest
+    static constexpr int cutoff_buckets = 8;
+
+    // one completed iteration of the main thread; nodes and time are cumulative
+    struct Iteration
+    {
+        int depth;
+        uint64_t nodes;
+        int64_t ms;
+    };
+
+    uint64_t nodes = 0;
+    uint64_t qnodes = 0;
+
+    uint64_t tt_probes = 0;
+    uint64_t tt_hits = 0;
+    uint64_t tt_cutoffs = 0;
+
+    uint64_t null_prunes = 0;
+    uint64_t razor_prunes = 0;
+    uint64_t rfp_prunes = 0;
+    uint64_t futility_prunes = 0;
+    uint64_t lmp_prunes = 0;
+
+    uint64_t lmr_researches = 0;
+
+    // static evals requested outside the TT, and how many the eval cache answered
+    uint64_t evals = 0;
+    uint64_t eval_cache_hits = 0;
+    uint64_t lazy_evals = 0; // stopped before the pawn structure
+
+    std::array<uint64_t, cutoff_buckets> cutoffs{};
+
+    std::vector<Iteration> iterations;
+
+    // add another thread's counters (iterations are left alone)
+    void merge(const SearchStats& other);
+
+    // print counters, cutoff distribution and NPS/EBF per depth
+    void print() const;
+};
+
+// one search thread: its own killers and history, a shared transposition table
+class SearchWorker
 {
 public:
-    // initialize with maximum depth
-    Search(int max);
+    SearchWorker(int max, Search& owner, bool main);
 
-    // modifies references if there are possible moves, otherwise returns false
-    bool best_move(const Board& b, Move& out_best, double& eval);
+    // iterative deepening to max_depth + depth_offset; returns false if there are no moves
+    bool search(const Board& b, int depth_offset, Move& out_best, int& out_eval);
 
 private:
+    // reads history scores for ordering
+    friend class MovePicker;
+
+    // reads node counts for the node budget
+    friend class Search;
+
     static constexpr int infinity = 1000000;
     static constexpr int mate_score = 100000;
-    static constexpr int delta_margin = Values::material_value[static_cast<int>(PieceType::Queen)];
+    // a queen: no single capture gains more, and it follows loaded parameters
+    static inline int delta_margin() { return Values::params.material_value[static_cast<int>(PieceType::Queen)]; }
     static constexpr int max_history = 16384;
+
+    // mate scores are stored in the TT just below the int16_t limit, everything else is clamped under them
+    static constexpr int tt_mate = 32000;
+    static constexpr int mate_window = 1000;
     
+    // how often the main thread looks at the clock and node budget
+    static constexpr uint64_t poll_interval = 1024;
+
     int max_depth;
     std::vector<std::array<Move, 2>> killers;
     int history[2][64][64];
     int butterfly[2][64][64];
-    TranspositionTable tt;
+    TranspositionTable& tt;
+    EvalCache& eval_cache;
+    const std::atomic<bool>& stop;
+
+    // the main thread enforces limits on behalf of everyone
+    Search& owner;
+    bool main;
+
+    // written only by this thread, read by the main thread for the node budget
+    std::atomic<uint64_t> nodes;
+
+    // this thread's share of the statistics
+    SearchStats stats;
+
+    // set by time, node budget or the main thread finishing
+    inline bool stopped() const { return stop.load(std::memory_order_relaxed); }
+
+    // count a node; the main thread also polls the limits
+    void count_node();
+
+    // static eval through the shared eval cache
+    int evaluate(const Board& board);
+
+    // lazy static eval; only guaranteed exact inside (alpha, beta)
+    int evaluate(const Board& board, int alpha, int beta);
 
     // mutable Board because of make_move/unmake_move
     int pvs(Board& board, int depth, int alpha, int beta, bool null_move_allowed = true);
@@ -37,8 +153,8 @@ private:
     // quiescence search
     int quiesce(Board& board, int depth, int alpha, int beta);
 
-    // move ordering by importance
-    void order_moves(std::vector<Move>& moves, Board& board, int depth, const Move* pv_move = nullptr);
+    // move ordering by importance (root only; inner nodes use MovePicker)
+    void order_moves(MoveList& moves, Board& board, int depth, const Move* pv_move = nullptr);
 
     // clear history tables
     void clear_history();
@@ -52,6 +168,10 @@ private:
     // get history score
     int get_history_score(const Move& move, Color color) const;
 
+    // map scores to and from the 16-bit TT range
+    static int score_to_tt(int score);
+    static int score_from_tt(int score);
+
     // is move a capture
     inline bool is_capture(const Move& m) const
     {
@@ -63,28 +183,66 @@ private:
     {
         return m.flags & static_cast<uint8_t>(MoveFlag::Promotion);
     }
+};
 
-    // is move a check
-    inline bool gives_check(Board& board, const Move& m) const
-    {
-        board.make_move(m);
+// lazy SMP: every thread searches the same root, sharing only the transposition table
+class Search
+{
+public:
+    // deepest iteration when searching on time or nodes
+    static constexpr int max_ply = 64;
+
+    // initialize with maximum depth, total number of threads and hash size in MB
+    Search(int max, int threads = 1, size_t hash_mb = TranspositionTable::default_mb);
 
-        Color foe = board.turn();
-        uint64_t king = board.pieces(foe, PieceType::King);
+    // modifies references if there are possible moves, otherwise returns false
+    bool best_move(const Board& b, Move& out_best, double& eval, const SearchLimits& limits = SearchLimits{});
 
-        if(!king)
-        {
-            board.unmake_move();
-            return false;
-        }
+    // forget earlier games: empty the TT, eval cache and every thread's pawn hash, and reset history and killers
+    void clear();
 
-        int king_sq = __builtin_ctzll(king);
-        bool check = board.is_attacked(king_sq, foe == Color::White ? Color::Black : Color::White);
+    // the transposition table, for reporting and for moving it to or from disk between searches
+    inline const TranspositionTable& hash() const { return tt; }
+    inline TranspositionTable& hash() { return tt; }
 
-        board.unmake_move();
+    // statistics of the last best_move call
+    inline const SearchStats& stats() const { return last_stats; }
 
-        return check;
-    }
+private:
+    friend class SearchWorker;
+
+    // never plan to use the last moments on the clock
+    static constexpr int64_t move_overhead = 30;
+    static constexpr int64_t moves_to_go = 30;
+
+    TranspositionTable tt;
+    EvalCache eval_cache;
+    std::atomic<bool> stop;
+
+    SearchStats last_stats;
+
+    // current limits and the derived time bounds (ms, 0 = none)
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point start_time;
+    int64_t soft_time;
+    int64_t hard_time;
+
+    // workers[0] runs on the calling thread, the rest on the pool
+    std::vector<std::unique_ptr<SearchWorker>> workers;
+    ThreadPool pool;
+
+    // set soft and hard bounds from the limits for the side to move
+    void init_time(Color us);
+
+    inline int64_t elapsed() const { return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count(); }
+
+    uint64_t total_nodes() const;
+
+    // hard limits, polled from inside the main thread's search
+    void check_limits();
+
+    // soft limit between iterations; a stable best move ends the search sooner
+    bool soft_limit_reached(int stable_iterations) const;
 };
 
 }
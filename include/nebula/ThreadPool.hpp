@@ -0,0 +1,48 @@
+#ifndef NEBULA_THREADPOOL_HPP
+#define NEBULA_THREADPOOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nebula
+{
+
+// fixed set of threads that sleep between jobs instead of being respawned
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    inline int size() const { return static_cast<int>(threads.size()); }
+
+    // run job(i) on every pool thread i; returns immediately
+    void start(const std::function<void(int)>& job);
+
+    // block until every thread has finished the current job
+    void wait();
+
+private:
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    std::function<void(int)> current_job;
+    unsigned long generation;
+    int running;
+    bool quit;
+
+    void loop(int index);
+};
+
+}
+
+#endif
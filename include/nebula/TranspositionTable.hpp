@@ -2,44 +2,159 @@
 #define NEBULA_TRANSPOSITIONTABLE_HPP
 
 #include "nebula/Board.hpp"
+#include "nebula/LargeMemory.hpp"
+#include "nebula/ThreadPool.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <string>
 
 namespace nebula
 {
 
 enum class TTFlag : uint8_t { Exact, LowerBound, UpperBound };
 
-struct TTEntry
+// a successful probe, unpacked from its entry
+struct TTData
+{
+    int eval;
+    int depth;
+    TTFlag flag;
+    uint16_t move; // Move::encode(); Board::decode_move turns it back into a move
+    int static_eval; // TranspositionTable::no_eval if it wasn't computed
+};
+
+// one cache line of lockless entries sharing an index: six data words, then a check per entry
+struct alignas(64) TTCluster
 {
-    uint64_t key = 0;
-    int eval = 0;
-    int depth = -1;
-    TTFlag flag = TTFlag::Exact;
-    Move move;
+    static constexpr int size = 6;
 
-    inline bool is_valid(uint64_t probe_key) const { return key == probe_key; }
+    // move | eval << 16 | depth << 32 | gen_bound << 40 | static eval << 48;
+    // gen_bound is generation << 2 | (flag + 1), 0 when empty
+    std::atomic<uint64_t> data[size];
+
+    // low key bits XOR the data word folded to 16 bits, so another position's entry
+    // and a word torn by a racing store both read as a miss
+    std::atomic<uint16_t> check[size];
 };
 
+static_assert(sizeof(TTCluster) == 64, "a cluster must fill exactly one cache line");
+
+// shared by all search threads without locks
 class TranspositionTable
 {
 public:
-    TranspositionTable();
+    static constexpr size_t default_mb = 16;
+
+    // stored evals must fit in an int16_t; callers map mate scores into range
+    static constexpr int max_eval = 32767;
+
+    // static eval slot of an entry whose node never evaluated
+    static constexpr int no_eval = -32768;
 
+    TranspositionTable(size_t mb = default_mb);
+
+    // reallocate to at most bytes of clusters (at least one); contents are lost
+    void resize(size_t bytes);
+
+    // back the table with a file that outlives the process: a missing or empty file becomes an
+    // empty table of bytes, a table file is mapped as is, whatever its size; any other file is
+    // left untouched and error says why
+    bool attach(const std::string& path, size_t bytes, std::string& error);
+
+    // map a saved table copy-on-write, without reading it in; false if path isn't a table file
+    bool load(const std::string& path);
+
+    // write the table to path; for the attached file this is just a flush
+    bool save(const std::string& path);
+
+    // empty every entry; with a pool the table is split between its threads and the caller
     void clear();
+    void clear(ThreadPool& pool);
+
+    // start a new search; older entries become preferred victims (not while searching)
+    inline void new_search() { generation = (generation + 1) & generation_mask; }
+
+    inline size_t size() const { return clusters * TTCluster::size; }
 
-    // returns pointer to entry or nullptr
-    const TTEntry* probe(uint64_t key) const;
-    TTEntry* probe(uint64_t key);
+    // size and page kind of the backing memory
+    inline std::string describe() const { return memory.describe(); }
+
+    // fills out and returns true on a hit, which is refreshed to the current generation
+    bool probe(uint64_t key, TTData& out);
+
+    // pull the key's cluster toward the cache ahead of a probe
+    inline void prefetch(uint64_t key) const { __builtin_prefetch(&table[index(key)]); }
 
     // store new entry
-    void store(uint64_t key, int eval, int depth, TTFlag flag, Move move);
+    void store(uint64_t key, int eval, int depth, TTFlag flag, uint16_t move, int static_eval = no_eval);
 
 private:
-    static constexpr size_t kNumEntries = 1 << 20; // 1M entries (~16 MB)
-    static constexpr size_t kIndexMask = kNumEntries - 1;
+    // weight of one search of age against one ply of depth when picking a victim
+    static constexpr int age_weight = 8;
+
+    // generations are six bits wide
+    static constexpr uint8_t generation_mask = 0x3F;
+
+    // first bytes of a table file; one cache line, so the clusters after it stay aligned
+    struct alignas(64) FileHeader
+    {
+        static constexpr char signature[8] = { 'N', 'E', 'B', 'U', 'L', 'A', 'T', 'T' };
+        static constexpr uint32_t current_version = 2;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t cluster_bytes;
+        uint64_t clusters;
+        uint8_t generation;
+    };
+
+    LargeMemory memory;
+    TTCluster* table;
+    size_t clusters;
+    uint8_t generation;
+
+    // set while the table lives in a file
+    FileHeader* header;
+    std::string attached_path;
+
+    // map an existing table file; shared writes go back to the file
+    bool map_table(const std::string& path, bool shared);
+
+    // take over a file mapping laid out as header + clusters
+    void adopt(LargeMemory&& file, size_t count);
+
+    void fill_header(FileHeader& h) const;
+
+    // multiply-shift: maps the key onto [0, size) without needing a power of two
+    inline size_t index(uint64_t key) const { return static_cast<size_t>((static_cast<unsigned __int128>(key) * clusters) >> 64); }
+
+    // the check word of key with data; the cluster index comes from the high key bits, so the low ones are free
+    static inline uint16_t check_of(uint64_t key, uint64_t data)
+    {
+        return static_cast<uint16_t>(key ^ data ^ (data >> 16) ^ (data >> 32) ^ (data >> 48));
+    }
+
+    // fields of a data word
+    static inline uint16_t move_of(uint64_t data) { return static_cast<uint16_t>(data); }
+    static inline int eval_of(uint64_t data) { return static_cast<int16_t>(data >> 16); }
+    static inline int depth_of(uint64_t data) { return static_cast<int8_t>(data >> 32); }
+    static inline uint8_t gen_bound_of(uint64_t data) { return static_cast<uint8_t>(data >> 40); }
+    static inline int static_eval_of(uint64_t data) { return static_cast<int16_t>(data >> 48); }
+
+    static inline uint64_t pack(uint16_t move, int eval, int depth, uint8_t gen_bound, int static_eval)
+    {
+        return static_cast<uint64_t>(move)
+            | static_cast<uint64_t>(static_cast<uint16_t>(eval)) << 16
+            | static_cast<uint64_t>(static_cast<uint8_t>(depth)) << 32
+            | static_cast<uint64_t>(gen_bound) << 40
+            | static_cast<uint64_t>(static_cast<uint16_t>(static_eval)) << 48;
+    }
 
-    std::vector<TTEntry> table;
+    // searches since the entry was last touched, wrapping at 64
+    inline int age(uint64_t data) const { return (generation - (gen_bound_of(data) >> 2)) & generation_mask; }
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -1,12 +1,22 @@
 #ifndef NEBULA_VALUES_HPP
 #define NEBULA_VALUES_HPP
 
+#include "nebula/Score.hpp"
+
+#include <string>
+
 namespace nebula
 {
 
-struct Values
+// build with -DNEBULA_TUNABLE=1 to read the weights from a runtime block that --params can load
+#ifndef NEBULA_TUNABLE
+#define NEBULA_TUNABLE 0
+#endif
+
+// every tunable evaluation weight, with the engine's own values as defaults
+struct alignas(64) EvalParams
 {
-    static constexpr int material_value[6] =
+    int material_value[6] =
     {
         100, // pawn
         320, // knight
@@ -16,7 +26,7 @@ struct Values
         0    // King
     };
 
-    static constexpr int pst[6][64] =
+    int pst[6][64] =
     {
         // pawn
         {
@@ -91,7 +101,7 @@ struct Values
         }
     };
 
-    static constexpr int pst_endgame[6][64] =
+    int pst_endgame[6][64] =
     {
         // pawn
         {
@@ -163,21 +173,56 @@ struct Values
         }
     };
 
-    // castling bonuses
-    static constexpr int castle_rights_bonus = 30;
-    static constexpr int castled_position_bonus = 75;
+    // castling bonuses (opening only)
+    Score castle_rights_bonus = Score(30, 0);
+    Score castled_position_bonus = Score(75, 0);
+
+    // pawn weaknesses; isolated pawns hurt half as much again in the endgame
+    Score isolated_pawn_penalty = Score(25, 37);
+    Score doubled_pawn_penalty = Score(20, 20);
+    Score backward_pawn_penalty = Score(15, 15);
 
-    // pawn weaknesses
-    static constexpr int isolated_pawn_penalty = 25;
-    static constexpr int doubled_pawn_penalty = 20;
-    static constexpr int backward_pawn_penalty = 15;
+    // passed pawns by relative rank; worth 2.5 times as much in the endgame
+    Score passed_pawn_bonus[8] =
+    {
+        Score(0, 0), Score(10, 25), Score(20, 50), Score(40, 100),
+        Score(80, 200), Score(150, 375), Score(250, 625), Score(0, 0)
+    };
+    Score connected_passed_pawn_bonus = Score(15, 15);
+    Score protected_passed_pawn_bonus = Score(10, 10);
+};
 
-    // passed pawns
-    static constexpr int base_values[] = { 0, 10, 20, 40, 80, 150, 250, 0 };
-    static constexpr int connected_passed_pawn_bonus = 15;
-    static constexpr int protected_passed_pawn_bonus = 10;
+struct Values
+{
+#if NEBULA_TUNABLE
+    // starts out as EvalParams{}; only load() writes it, before any board exists
+    static EvalParams params;
+#else
+    // folded into the code like any other constant
+    static constexpr EvalParams params{};
+#endif
+
+    static constexpr bool tunable = NEBULA_TUNABLE;
+
+    // read tuner output into params: tune_evaluation.py's results file, or just an object of
+    // "name": number or (nested) number array named after the EvalParams fields. A Score takes
+    // [mg, eg] or the tuner's single value, phased the way the tuner does; fields not listed keep
+    // their value. On failure params is unchanged and error says why
+    static bool load(const std::string& path, std::string& error);
+
+    // game phase: weight of each piece still on the board
+    static constexpr int phase_weight[6] =
+    {
+        0, // pawn
+        1, // knight
+        1, // bishop
+        2, // rook
+        4, // queen
+        0  // king
+    };
+    static constexpr int max_phase = (phase_weight[1] * 2 + phase_weight[2] * 2 + phase_weight[3] * 2 + phase_weight[4] * 1) * 2;
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -7,6 +7,18 @@ std::array<uint64_t, 64> AttackTables::knight;
 std::array<uint64_t, 64> AttackTables::king;
 std::array<std::array<uint64_t, 64>, 2> AttackTables::pawn;
 
+std::array<Magic, 64> AttackTables::rook_magics;
+std::array<Magic, 64> AttackTables::bishop_magics;
+
+std::array<uint64_t, 0x19000> AttackTables::rook_table;
+std::array<uint64_t, 0x1480> AttackTables::bishop_table;
+
+std::array<std::array<uint64_t, 64>, 64> AttackTables::between;
+std::array<std::array<uint64_t, 64>, 64> AttackTables::line;
+
+std::array<uint64_t, 8> AttackTables::adjacent_files;
+std::array<std::array<uint64_t, 64>, 2> AttackTables::passed_mask;
+
 struct TablesInit
 {
     static constexpr int knight_dirs[8][2] =
@@ -25,6 +37,109 @@ struct TablesInit
         { { -1, -1 }, { -1, 1 } }
     };
 
+    // walk rays square-by-square; only used to fill the magic tables
+    template<size_t N>
+    static uint64_t sliding_attack(int sq, uint64_t occ, const std::array<std::pair<int, int>, N>& dirs)
+    {
+        uint64_t att = 0ULL;
+
+        int f0 = sq & 7, r0 = sq >> 3;
+
+        for(auto [df, dr] : dirs)
+        {
+            int f = f0 + df, r = r0 + dr;
+            while(f >= 0 && f < 8 && r >= 0 && r < 8)
+            {
+                uint64_t m = 1ULL << (r * 8 + f);
+
+                att |= m;
+
+                // blocked
+                if(occ & m)
+                    break;
+
+                f += df;
+                r += dr;
+            }
+        }
+
+        return att;
+    }
+
+    // xorshift64* generator, fixed seeds so magics are the same every run
+    static uint64_t rand64(uint64_t& s)
+    {
+        s ^= s >> 12;
+        s ^= s << 25;
+        s ^= s >> 27;
+
+        return s * 2685821657736338717ULL;
+    }
+
+    // find magics for every square and fill the shared attack table
+    template<size_t N>
+    static void init_magics(uint64_t* table, std::array<Magic, 64>& magics, const std::array<std::pair<int, int>, N>& dirs)
+    {
+        static constexpr uint64_t rank_1 = 0xFFULL, rank_8 = 0xFFULL << 56;
+        static constexpr uint64_t file_a = 0x0101010101010101ULL, file_h = 0x8080808080808080ULL;
+
+        uint64_t occupancy[4096], reference[4096];
+        int epoch[4096] = { 0 };
+        int cnt = 0;
+
+        // per-rank seeds known to find magics quickly with this generator
+        static constexpr uint64_t seeds[8] = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+
+        for(int sq = 0; sq < 64; ++sq)
+        {
+            uint64_t seed = seeds[sq >> 3];
+
+            // board edges are not relevant unless the piece is on them
+            uint64_t edges = ((rank_1 | rank_8) & ~(0xFFULL << ((sq >> 3) * 8))) | ((file_a | file_h) & ~(file_a << (sq & 7)));
+
+            Magic& m = magics[sq];
+            m.mask = sliding_attack(sq, 0ULL, dirs) & ~edges;
+            m.shift = 64 - __builtin_popcountll(m.mask);
+            m.attacks = (sq == 0) ? table : magics[sq - 1].attacks + (1ULL << (64 - magics[sq - 1].shift));
+
+            // enumerate all subsets of the mask (Carry-Rippler)
+            int size = 0;
+            uint64_t b = 0ULL;
+            do
+            {
+                occupancy[size] = b;
+                reference[size] = sliding_attack(sq, b, dirs);
+                ++size;
+
+                b = (b - m.mask) & m.mask;
+            } while(b);
+
+            // try sparse random numbers until one maps without destructive collisions
+            for(int i = 0; i < size;)
+            {
+                do
+                {
+                    m.magic = rand64(seed) & rand64(seed) & rand64(seed);
+                } while(__builtin_popcountll((m.mask * m.magic) >> 56) < 6);
+
+                ++cnt;
+                for(i = 0; i < size; ++i)
+                {
+                    unsigned idx = m.index(occupancy[i]);
+
+                    if(epoch[idx] < cnt)
+                    {
+                        epoch[idx] = cnt;
+                        m.attacks[idx] = reference[i];
+                    } else if(m.attacks[idx] != reference[i])
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
     TablesInit()
     {
         for(int sq = 0; sq < 64; ++sq)
@@ -71,6 +186,49 @@ struct TablesInit
                 AttackTables::pawn[c][sq] = pm;
             }
         }
+
+        // sliders
+        init_magics(AttackTables::rook_table.data(), AttackTables::rook_magics, AttackTables::rook_dirs);
+        init_magics(AttackTables::bishop_table.data(), AttackTables::bishop_magics, AttackTables::bishop_dirs);
+
+        // lines and segments between aligned squares
+        for(int s1 = 0; s1 < 64; ++s1)
+        {
+            for(int s2 = 0; s2 < 64; ++s2)
+            {
+                uint64_t b1 = 1ULL << s1, b2 = 1ULL << s2;
+
+                AttackTables::between[s1][s2] = 0ULL;
+                AttackTables::line[s1][s2] = 0ULL;
+
+                if(s1 == s2)
+                    continue;
+
+                if(AttackTables::attacks<PieceType::Rook>(s1, 0ULL) & b2)
+                {
+                    AttackTables::line[s1][s2] = (AttackTables::attacks<PieceType::Rook>(s1, 0ULL) & AttackTables::attacks<PieceType::Rook>(s2, 0ULL)) | b1 | b2;
+                    AttackTables::between[s1][s2] = AttackTables::attacks<PieceType::Rook>(s1, b2) & AttackTables::attacks<PieceType::Rook>(s2, b1);
+                } else if(AttackTables::attacks<PieceType::Bishop>(s1, 0ULL) & b2)
+                {
+                    AttackTables::line[s1][s2] = (AttackTables::attacks<PieceType::Bishop>(s1, 0ULL) & AttackTables::attacks<PieceType::Bishop>(s2, 0ULL)) | b1 | b2;
+                    AttackTables::between[s1][s2] = AttackTables::attacks<PieceType::Bishop>(s1, b2) & AttackTables::attacks<PieceType::Bishop>(s2, b1);
+                }
+            }
+        }
+
+        // pawn structure masks
+        for(int f = 0; f < 8; ++f)
+            AttackTables::adjacent_files[f] = AttackTables::adjacent(AttackTables::file_a << f);
+
+        for(int sq = 0; sq < 64; ++sq)
+        {
+            uint64_t files = (AttackTables::file_a << (sq & 7)) | AttackTables::adjacent_files[sq & 7];
+            uint64_t rank = 0xFFULL << (sq & 56);
+
+            // own and adjacent files, every rank ahead of the pawn
+            for(int c = 0; c < 2; ++c)
+                AttackTables::passed_mask[c][sq] = files & AttackTables::front_span(static_cast<Color>(c), rank);
+        }
     }
 } _tInit;
 
@@ -1,11 +1,13 @@
 #include "nebula/Board.hpp"
 #include "nebula/AttackTables.hpp"
+#include "nebula/Values.hpp"
 
 #include <random>
 #include <sstream>
 #include <stdexcept>
 #include <cctype>
 #include <ostream>
+#include <algorithm>
 
 namespace nebula
 {
@@ -63,6 +65,27 @@ bool Move::operator==(const Move& other) const
     return from == other.from && to == other.to && piece == other.piece && capture == other.capture && promo == other.promo && flags == other.flags;
 }
 
+void MoveList::sort()
+{
+    // insertion sort: lists are short and usually close to ordered
+    for(int i = 1; i < count; ++i)
+    {
+        Move m = moves[i];
+        int s = scores[i];
+
+        int j = i - 1;
+        while(j >= 0 && scores[j] < s)
+        {
+            moves[j + 1] = moves[j];
+            scores[j + 1] = scores[j];
+            --j;
+        }
+
+        moves[j + 1] = m;
+        scores[j + 1] = s;
+    }
+}
+
 Board::Board(const std::string& fen):
     pos_history{},
     history{},
@@ -75,7 +98,9 @@ Board::Board(const std::string& fen):
     half_moves{0},
     full_move{1},
     mailbox{},
-    zobrist_key{0ULL}
+    zobrist_key{0ULL},
+    pawn_zobrist_key{0ULL},
+    eval_terms{}
 {
     // reset mailbox
     mailbox.fill(-1);
@@ -185,9 +210,22 @@ void Board::make_move(const Move& move)
         en_passant_square,
         half_moves,
         full_move,
-        zobrist_key
+        zobrist_key,
+        pawn_zobrist_key,
+        eval_terms
     });
 
+    // the pieces moved below are recorded against the new ply
+    if(NNUE::enabled())
+    {
+        if(nnue_states.size() <= history.size())
+            nnue_states.resize(history.size() + 1);
+
+        NNUEState& state = nnue_states[history.size()];
+        state.delta.count = 0;
+        state.computed[0] = state.computed[1] = false;
+    }
+
     // update half move counter
     if(decode_piece(move.piece) == as_int(PieceType::Pawn) || (move.flags & as_int(MoveFlag::Capture)))
         half_moves = 0;
@@ -288,6 +326,8 @@ void Board::unmake_move()
     half_moves = u.prev_half_moves;
     full_move = u.prev_full_move;
     zobrist_key = u.prev_zobrist_key;
+    pawn_zobrist_key = u.prev_pawn_zobrist_key;
+    eval_terms = u.prev_eval_terms;
 
     // clear without modifying Zobrist key
     auto clear_sq = [&](int sq)
@@ -454,97 +494,470 @@ bool Board::is_repetition() const
     return false;
 }
 
-std::vector<Move> Board::generate_pseudo() const
+MoveList Board::generate_pseudo() const
 {
-    std::vector<Move> out;
+    MoveList out;
 
-    int color = as_int(side_to_move);
+    uint64_t target = ~color_bb[as_int(side_to_move)];
 
     // pawns
-    generate_pawn_moves(out);
+    generate_pawn_moves(out, ~0ULL, 0ULL, true, true);
 
     // knights
-    generate_knight_moves(out);
+    generate_knight_moves(out, target, 0ULL);
+
+    // sliding pieces
+    generate_slider_moves<PieceType::Rook>(out, target, 0ULL);
+    generate_slider_moves<PieceType::Bishop>(out, target, 0ULL);
+    generate_slider_moves<PieceType::Queen>(out, target, 0ULL);
+
+    // kings
+    generate_king_moves(out, target, false);
+    generate_castling(out);
+
+    return out;
+}
+
+MoveList Board::generate_moves() const
+{
+    MoveList out;
+
+    // no king to keep safe
+    if(!pieces_bb[as_int(side_to_move)][as_int(PieceType::King)])
+        return generate_pseudo();
+
+    if(in_check())
+        generate<GenType::Evasions>(out);
+    else
+        generate<GenType::NonEvasions>(out);
+
+    return out;
+}
+
+MoveList Board::generate_captures() const
+{
+    MoveList out;
+
+    generate<GenType::Captures>(out);
+
+    return out;
+}
+
+MoveList Board::generate_quiets() const
+{
+    MoveList out;
+
+    generate<GenType::Quiets>(out);
 
-    // lambda for sliding pieces
-    auto slide = [&](PieceType pt, const auto& dirs)
+    return out;
+}
+
+MoveList Board::generate_quiet_checks() const
+{
+    MoveList out;
+
+    int us = as_int(side_to_move);
+    int them = us ^ 1;
+
+    uint64_t their_king = pieces_bb[them][as_int(PieceType::King)];
+    if(!their_king)
+        return out;
+
+    int eksq = __builtin_ctzll(their_king);
+    uint64_t empty = ~all_pieces_bb;
+    uint64_t pinned = pinned_pieces();
+
+    // our pieces alone between one of our sliders and their king; moving off that line checks
+    uint64_t rooks = pieces_bb[us][as_int(PieceType::Rook)] | pieces_bb[us][as_int(PieceType::Queen)];
+    uint64_t bishops = pieces_bb[us][as_int(PieceType::Bishop)] | pieces_bb[us][as_int(PieceType::Queen)];
+    uint64_t snipers = (AttackTables::attacks<PieceType::Rook>(eksq, 0ULL) & rooks) | (AttackTables::attacks<PieceType::Bishop>(eksq, 0ULL) & bishops);
+
+    uint64_t discoverers = 0ULL;
+    while(snipers)
     {
-        uint64_t bb = pieces_bb[color][as_int(pt)];
-        uint64_t me = color_bb[color];
-        uint64_t foe = color_bb[color^1];
+        int sq = __builtin_ctzll(snipers);
+        snipers &= snipers - 1;
 
-        while(bb)
-        {
-            int from = __builtin_ctzll(bb);
-            bb &= bb - 1;
+        uint64_t blockers = AttackTables::between[eksq][sq] & all_pieces_bb;
+        if(blockers && !(blockers & (blockers - 1)))
+            discoverers |= blockers & color_bb[us];
+    }
 
-            int f0 = from & 0b111;
-            int r0 = from >> 3;
+    // squares each piece type gives check from
+    uint64_t bishop_checks = AttackTables::attacks<PieceType::Bishop>(eksq, all_pieces_bb);
+    uint64_t rook_checks = AttackTables::attacks<PieceType::Rook>(eksq, all_pieces_bb);
 
-            for(auto [df, dr] : dirs)
-            {
-                int f = f0 + df, r = r0 + dr;
-                while(f >= 0 && f < 8 && r >= 0 && r < 8)
-                {
-                    int to = r * 8 + f;
-                    uint64_t mask = 1ULL << to;
-
-                    // stop
-                    if(me & mask)
-                        break;
-
-                    // capture and stop
-                    if(foe & mask)
-                    {
-                        out.push_back(make_piece_move(from, to, color, pt, static_cast<uint8_t>(MoveFlag::Capture), static_cast<uint8_t>(mailbox[to])));
-                        break;
-                    }
-                    
-                    // keep sliding
-                    out.push_back(make_piece_move(from, to, color, pt, static_cast<uint8_t>(MoveFlag::Quiet)));
-                    
-                    f += df;
-                    r += dr;
-                }
-            }
-        }
+    // pawn pushes, promotions excluded like in generate<Quiets>
+    uint64_t pawns = pieces_bb[us][as_int(PieceType::Pawn)];
+    uint64_t pawn_checks = AttackTables::pawn[them][eksq];
+
+    int ksq = king_sq(side_to_move);
+    auto push_checks = [&](int from, int to)
+    {
+        bool checks = ((pawn_checks >> to) & 1) || (((discoverers >> from) & 1) && !((AttackTables::line[eksq][from] >> to) & 1));
+        bool pin_ok = !((pinned >> from) & 1) || ((AttackTables::line[ksq][from] >> to) & 1);
+
+        return checks && pin_ok;
     };
 
-    slide(PieceType::Rook, AttackTables::rook_dirs);
-    slide(PieceType::Bishop, AttackTables::bishop_dirs);
-    slide(PieceType::Queen, AttackTables::queen_dirs);
+    uint64_t single = (us == 0 ? pawns << 8 : pawns >> 8) & empty & ~promo_ranks;
+    uint64_t one_step = (us == 0 ? (pawns & rank_2) << 8 : (pawns & rank_7) >> 8) & empty;
+    uint64_t dbl = (us == 0 ? one_step << 8 : one_step >> 8) & empty;
 
-    // kings
-    generate_king_moves(out);
+    while(single)
+    {
+        int to = __builtin_ctzll(single);
+        single &= single - 1;
+
+        int from = to + (us == 0 ? -8 : 8);
+        if(push_checks(from, to))
+            out.push_back(make_pawn_move(from, to, us, PieceType::Pawn, static_cast<uint8_t>(MoveFlag::Quiet)));
+    }
+
+    while(dbl)
+    {
+        int to = __builtin_ctzll(dbl);
+        dbl &= dbl - 1;
+
+        int from = to + (us == 0 ? -16 : 16);
+        if(push_checks(from, to))
+            out.push_back(make_pawn_move(from, to, us, PieceType::Pawn, static_cast<uint8_t>(MoveFlag::DoublePawnPush)));
+    }
+
+    generate_checking_moves<PieceType::Knight>(out, AttackTables::knight[eksq], discoverers, eksq, pinned);
+    generate_checking_moves<PieceType::Rook>(out, rook_checks, discoverers, eksq, pinned);
+    generate_checking_moves<PieceType::Bishop>(out, bishop_checks, discoverers, eksq, pinned);
+    generate_checking_moves<PieceType::Queen>(out, rook_checks | bishop_checks, discoverers, eksq, pinned);
+
+    // the king only checks by discovery
+    if((discoverers >> ksq) & 1)
+        generate_king_moves(out, empty & ~AttackTables::line[eksq][ksq], true);
+
+    // at most two castling moves; the rook's check is easiest to test on the move
+    MoveList castles;
+    generate_castling(castles);
+
+    for(const Move& move : castles)
+        if(gives_check(move))
+            out.push_back(move);
 
     return out;
 }
 
-std::vector<Move> Board::generate_moves()
+MoveList Board::generate_evasions() const
 {
-    std::vector<Move> pseudo = generate_pseudo();
+    MoveList out;
 
-    std::vector<Move> legal;
-    legal.reserve(pseudo.size());
+    generate<GenType::Evasions>(out);
 
-    for(const auto& move : pseudo)
-        if(is_legal(move))
-            legal.push_back(move);
+    return out;
+}
+
+template<Board::GenType gt>
+void Board::generate(MoveList& moves) const
+{
+    int us = as_int(side_to_move);
+    uint64_t own = color_bb[us];
+    uint64_t enemy = color_bb[us ^ 1];
+
+    // squares pieces may land on
+    uint64_t target;
+
+    // squares that resolve a check (everything when not in check)
+    uint64_t mask = ~0ULL;
+
+    if constexpr(gt == GenType::Evasions)
+    {
+        int ksq = king_sq(side_to_move);
+        uint64_t checkers = attackers_to(ksq, all_pieces_bb) & enemy;
+
+        // the king can always try to step away
+        generate_king_moves(moves, ~own, true);
+
+        // double check: only king moves
+        if(checkers & (checkers - 1))
+            return;
 
-    return legal;
+        // otherwise capture the checker or block its ray
+        mask = AttackTables::between[ksq][__builtin_ctzll(checkers)] | checkers;
+        target = mask;
+    } else if constexpr(gt == GenType::Captures)
+    {
+        target = enemy;
+    } else if constexpr(gt == GenType::Quiets)
+    {
+        target = ~all_pieces_bb;
+    } else
+    {
+        target = ~own;
+    }
+
+    uint64_t pinned = pinned_pieces();
+
+    generate_pawn_moves(moves, mask, pinned, gt != GenType::Quiets, gt != GenType::Captures);
+    generate_knight_moves(moves, target, pinned);
+    generate_slider_moves<PieceType::Rook>(moves, target, pinned);
+    generate_slider_moves<PieceType::Bishop>(moves, target, pinned);
+    generate_slider_moves<PieceType::Queen>(moves, target, pinned);
+
+    if constexpr(gt != GenType::Evasions)
+        generate_king_moves(moves, target, true);
+
+    if constexpr(gt == GenType::Quiets || gt == GenType::NonEvasions)
+        generate_castling(moves);
 }
 
-bool Board::is_legal(const Move& move)
+bool Board::gives_check(const Move& move) const
 {
-    bool l;
+    int us = as_int(side_to_move);
+    uint64_t king = pieces_bb[us ^ 1][as_int(PieceType::King)];
+
+    if(!king)
+        return false;
+
+    int ksq = __builtin_ctzll(king);
+    uint64_t from_bb = 1ULL << move.from;
+    uint64_t to_bb = 1ULL << move.to;
+
+    // occupancy and our sliders after the move
+    uint64_t occ = (all_pieces_bb ^ from_bb) | to_bb;
+    uint64_t rooks = (pieces_bb[us][as_int(PieceType::Rook)] | pieces_bb[us][as_int(PieceType::Queen)]) & ~from_bb;
+    uint64_t bishops = (pieces_bb[us][as_int(PieceType::Bishop)] | pieces_bb[us][as_int(PieceType::Queen)]) & ~from_bb;
+
+    if(move.flags & as_int(MoveFlag::EnPassant))
+    {
+        occ ^= 1ULL << (move.to + (us == 0 ? -8 : 8));
+    } else if(move.flags & (as_int(MoveFlag::KingCastle) | as_int(MoveFlag::QueenCastle)))
+    {
+        bool king_side = move.flags & as_int(MoveFlag::KingCastle);
+        int rfrom = king_side ? move.from + 3 : move.from - 4;
+        int rto = king_side ? move.from + 1 : move.from - 1;
+
+        occ ^= (1ULL << rfrom) | (1ULL << rto);
+        rooks = (rooks & ~(1ULL << rfrom)) | (1ULL << rto);
+    }
+
+    // direct checks from the piece that lands on the destination
+    int pt = (move.flags & as_int(MoveFlag::Promotion)) ? move.promo : decode_piece(move.piece);
+    switch(as_piece_type(pt))
+    {
+        case PieceType::Pawn:
+            if(AttackTables::pawn[us][move.to] & king)
+                return true;
+            break;
+
+        case PieceType::Knight:
+            if(AttackTables::knight[move.to] & king)
+                return true;
+            break;
+
+        case PieceType::Bishop:
+            bishops |= to_bb;
+            break;
+
+        case PieceType::Rook:
+            rooks |= to_bb;
+            break;
+
+        case PieceType::Queen:
+            rooks |= to_bb;
+            bishops |= to_bb;
+            break;
+
+        case PieceType::King:
+            break;
+    }
+
+    // sliders seeing the king through the new occupancy (direct or discovered)
+    return (AttackTables::attacks<PieceType::Rook>(ksq, occ) & rooks) || (AttackTables::attacks<PieceType::Bishop>(ksq, occ) & bishops);
+}
+
+uint64_t Board::pinned_pieces() const
+{
+    int us = as_int(side_to_move);
+    int them = us ^ 1;
+    int ksq = king_sq(side_to_move);
+
+    // enemy sliders that would attack the king on an empty board
+    uint64_t rooks = pieces_bb[them][as_int(PieceType::Rook)] | pieces_bb[them][as_int(PieceType::Queen)];
+    uint64_t bishops = pieces_bb[them][as_int(PieceType::Bishop)] | pieces_bb[them][as_int(PieceType::Queen)];
+    uint64_t snipers = (AttackTables::attacks<PieceType::Rook>(ksq, 0ULL) & rooks) | (AttackTables::attacks<PieceType::Bishop>(ksq, 0ULL) & bishops);
+
+    uint64_t pinned = 0ULL;
+    while(snipers)
+    {
+        int sq = __builtin_ctzll(snipers);
+        snipers &= snipers - 1;
+
+        // exactly one piece in between, and it is ours
+        uint64_t blockers = AttackTables::between[ksq][sq] & all_pieces_bb;
+        if(blockers && !(blockers & (blockers - 1)))
+            pinned |= blockers & color_bb[us];
+    }
 
-    make_move(move);
+    return pinned;
+}
 
-    l = !is_attacked(king_sq(as_color(as_int(side_to_move) ^ 1)), side_to_move);
+uint64_t Board::attackers_to(int sq, uint64_t occ) const
+{
+    const int w = as_int(Color::White), b = as_int(Color::Black);
 
-    unmake_move();
+    uint64_t rooks = pieces_bb[w][as_int(PieceType::Rook)] | pieces_bb[b][as_int(PieceType::Rook)] | pieces_bb[w][as_int(PieceType::Queen)] | pieces_bb[b][as_int(PieceType::Queen)];
+    uint64_t bishops = pieces_bb[w][as_int(PieceType::Bishop)] | pieces_bb[b][as_int(PieceType::Bishop)] | pieces_bb[w][as_int(PieceType::Queen)] | pieces_bb[b][as_int(PieceType::Queen)];
 
-    return l;
+    return (AttackTables::pawn[w][sq] & pieces_bb[b][as_int(PieceType::Pawn)])
+         | (AttackTables::pawn[b][sq] & pieces_bb[w][as_int(PieceType::Pawn)])
+         | (AttackTables::knight[sq] & (pieces_bb[w][as_int(PieceType::Knight)] | pieces_bb[b][as_int(PieceType::Knight)]))
+         | (AttackTables::king[sq] & (pieces_bb[w][as_int(PieceType::King)] | pieces_bb[b][as_int(PieceType::King)]))
+         | (AttackTables::attacks<PieceType::Rook>(sq, occ) & rooks)
+         | (AttackTables::attacks<PieceType::Bishop>(sq, occ) & bishops);
+}
+
+bool Board::is_pseudo_legal(const Move& move) const
+{
+    int us = as_int(side_to_move);
+
+    if(move.from >= 64 || move.to >= 64 || move.from == move.to)
+        return false;
+
+    // the moving piece must be ours and where the move says it is
+    if(mailbox[move.from] != move.piece || decode_color(move.piece) != us)
+        return false;
+
+    uint64_t to_bb = 1ULL << move.to;
+    int pt = decode_piece(move.piece);
+
+    // castling is cheapest to check against the generator
+    if(move.flags & (as_int(MoveFlag::KingCastle) | as_int(MoveFlag::QueenCastle)))
+    {
+        MoveList castles;
+        generate_castling(castles);
+
+        return std::find(castles.begin(), castles.end(), move) != castles.end();
+    }
+
+    if(move.flags & as_int(MoveFlag::EnPassant))
+    {
+        int cap_sq = move.to + (us == 0 ? -8 : 8);
+
+        return pt == as_int(PieceType::Pawn) && move.to == en_passant_square && (AttackTables::pawn[us][move.from] & to_bb) && move.capture == mailbox[cap_sq] && move.flags == (as_int(MoveFlag::EnPassant) | as_int(MoveFlag::Capture));
+    }
+
+    // the destination must match the recorded capture
+    uint8_t expected = 0;
+    if(color_bb[us ^ 1] & to_bb)
+    {
+        if(move.capture != mailbox[move.to])
+            return false;
+
+        expected |= as_int(MoveFlag::Capture);
+    } else if((color_bb[us] & to_bb) || move.capture != 0xFF)
+    {
+        return false;
+    }
+
+    if(pt == as_int(PieceType::Pawn))
+    {
+        int forward = us == 0 ? 8 : -8;
+
+        if(expected & as_int(MoveFlag::Capture))
+        {
+            if(!(AttackTables::pawn[us][move.from] & to_bb))
+                return false;
+        } else if(move.to == move.from + 2 * forward)
+        {
+            if(!((1ULL << move.from) & (us == 0 ? rank_2 : rank_7)) || (all_pieces_bb & (1ULL << (move.from + forward))))
+                return false;
+
+            expected |= as_int(MoveFlag::DoublePawnPush);
+        } else if(move.to != move.from + forward)
+        {
+            return false;
+        }
+
+        if(to_bb & promo_ranks)
+        {
+            if(move.promo < as_int(PieceType::Knight) || move.promo > as_int(PieceType::Queen))
+                return false;
+
+            expected |= as_int(MoveFlag::Promotion);
+        } else if(move.promo != 0xFF)
+        {
+            return false;
+        }
+
+        return move.flags == expected;
+    }
+
+    uint64_t attacks;
+    switch(as_piece_type(pt))
+    {
+        case PieceType::Knight:
+            attacks = AttackTables::attacks<PieceType::Knight>(move.from, all_pieces_bb);
+            break;
+
+        case PieceType::Bishop:
+            attacks = AttackTables::attacks<PieceType::Bishop>(move.from, all_pieces_bb);
+            break;
+
+        case PieceType::Rook:
+            attacks = AttackTables::attacks<PieceType::Rook>(move.from, all_pieces_bb);
+            break;
+
+        case PieceType::Queen:
+            attacks = AttackTables::attacks<PieceType::Queen>(move.from, all_pieces_bb);
+            break;
+
+        default:
+            attacks = AttackTables::attacks<PieceType::King>(move.from, all_pieces_bb);
+            break;
+    }
+
+    return (attacks & to_bb) && move.promo == 0xFF && move.flags == expected;
+}
+
+bool Board::is_legal(const Move& move) const
+{
+    int us = as_int(side_to_move);
+    uint64_t king = pieces_bb[us][as_int(PieceType::King)];
+
+    if(!king)
+        return true;
+
+    int ksq = __builtin_ctzll(king);
+    uint64_t from_bb = 1ULL << move.from;
+    uint64_t to_bb = 1ULL << move.to;
+
+    // castling already verified the king's path
+    if(move.flags & (as_int(MoveFlag::KingCastle) | as_int(MoveFlag::QueenCastle)))
+        return true;
+
+    // king steps: the destination must be safe once the king has left
+    if(move.from == ksq)
+        return !(attackers_to(move.to, all_pieces_bb ^ from_bb) & color_bb[us ^ 1]);
+
+    // en passant: test the resulting occupancy
+    if(move.flags & as_int(MoveFlag::EnPassant))
+    {
+        uint64_t cap_bb = 1ULL << (move.to + (us == 0 ? -8 : 8));
+        uint64_t occ = (all_pieces_bb ^ from_bb ^ cap_bb) | to_bb;
+
+        return !(attackers_to(ksq, occ) & color_bb[us ^ 1] & ~cap_bb);
+    }
+
+    // in check: must capture the only checker or block it
+    uint64_t checkers = attackers_to(ksq, all_pieces_bb) & color_bb[us ^ 1];
+    if(checkers)
+    {
+        if(checkers & (checkers - 1))
+            return false;
+
+        if(!((AttackTables::between[ksq][__builtin_ctzll(checkers)] | checkers) & to_bb))
+            return false;
+    }
+
+    // pinned pieces stay on the line through the king
+    return !(pinned_pieces() & from_bb) || (AttackTables::line[ksq][move.from] & to_bb);
 }
 
 bool Board::is_attacked(int sq, Color by) const
@@ -580,59 +993,15 @@ bool Board::is_attacked(int sq, Color by) const
     if (AttackTables::king[sq] & pieces_bb[c][as_int(PieceType::King)])
         return true;
     
-    int f0 = sq & 7, r0 = sq >> 3;
-
     // rook-like sliding attacks
-    for(auto [df, dr] : AttackTables::rook_dirs)
-    {
-        int f = f0 + df, r = r0 + dr;
-        while(f >= 0 && f < 8 && r >= 0 && r < 8)
-        {
-            int t = (r << 3) | f;
-            uint64_t m = 1ULL << t;
-
-            // hit a piece
-            if(occ & m)
-            {
-                int code = mailbox[t];
-
-                int col = decode_color(code), pc = decode_piece(code);
-
-                if(col == c && (pc == as_int(PieceType::Rook) || pc == as_int(PieceType::Queen)))
-                    return true;
-
-                break;
-            }
-
-            f += df; r += dr;
-        }
-    }
+    uint64_t rooks = pieces_bb[c][as_int(PieceType::Rook)] | pieces_bb[c][as_int(PieceType::Queen)];
+    if(AttackTables::attacks<PieceType::Rook>(sq, occ) & rooks)
+        return true;
 
     // bishop-like sliding attacks
-    for(auto [df, dr] : AttackTables::bishop_dirs)
-    {
-        int f = f0 + df, r = r0 + dr;
-        while(f >= 0 && f < 8 && r >= 0 && r < 8)
-        {
-            int t = (r << 3) | f;
-            uint64_t m = 1ULL << t;
-
-            // hit a piece
-            if(occ & m)
-            {
-                int code = mailbox[t];
-
-                int col = decode_color(code), pc = decode_piece(code);
-
-                if(col == c && (pc == as_int(PieceType::Bishop) || pc == as_int(PieceType::Queen)))
-                    return true;
-
-                break;
-            }
-
-            f += df; r += dr;
-        }
-    }
+    uint64_t bishops = pieces_bb[c][as_int(PieceType::Bishop)] | pieces_bb[c][as_int(PieceType::Queen)];
+    if(AttackTables::attacks<PieceType::Bishop>(sq, occ) & bishops)
+        return true;
 
     return false;
 }
@@ -674,6 +1043,8 @@ void Board::set_piece(int sq, Color c, PieceType pt)
 
     // update Zobrist key
     update_zobrist_piece(sq, c, pt);
+
+    update_eval_terms(sq, as_int(c), as_int(pt), 1);
 }
 
 void Board::remove_piece(int sq)
@@ -706,6 +1077,87 @@ void Board::remove_piece(int sq)
 
     // update Zobrist key
     update_zobrist_piece(sq, as_color(c), as_piece_type(pt));
+
+    update_eval_terms(sq, c, pt, -1);
+}
+
+void Board::update_eval_terms(int sq, int c, int pt, int sign)
+{
+    // black reads the tables mirrored vertically and counts against white
+    int pst_sq = c == 0 ? sq : sq ^ 56;
+    int side = c == 0 ? sign : -sign;
+
+    eval_terms.psq += Score(Values::params.material_value[pt] + Values::params.pst[pt][pst_sq], Values::params.material_value[pt] + Values::params.pst_endgame[pt][pst_sq]) * side;
+    eval_terms.phase += sign * Values::phase_weight[pt];
+
+    if(NNUE::enabled() && history.size() < nnue_states.size())
+    {
+        NNUE::Delta& delta = nnue_states[history.size()].delta;
+
+        // outside make_move (e.g. setting up a FEN) the count is already -1
+        if(delta.count >= 0 && delta.count < NNUE::Delta::capacity)
+            delta.changes[delta.count++] = { static_cast<int8_t>(sq), static_cast<int8_t>(c), static_cast<int8_t>(pt), static_cast<int8_t>(sign) };
+        else
+            delta.count = -1;
+    }
+}
+
+const NNUE::Accumulator& Board::accumulator() const
+{
+    size_t ply = history.size();
+
+    // plies never reached through make_move start out unknown
+    if(nnue_states.size() <= ply)
+        nnue_states.resize(ply + 1);
+
+    NNUEState& current = nnue_states[ply];
+
+    for(int p = 0; p < num_colors; ++p)
+    {
+        if(current.computed[p])
+            continue;
+
+        // walk back to a computed ply, unless this side's king moved on the way
+        size_t from = ply;
+        bool rebuild = false;
+
+        while(!nnue_states[from].computed[p])
+        {
+            const NNUE::Delta& delta = nnue_states[from].delta;
+
+            bool king_moved = false;
+            for(int i = 0; i < delta.count; ++i)
+                if(delta.changes[i].piece == as_int(PieceType::King) && delta.changes[i].color == p)
+                    king_moved = true;
+
+            if(from == 0 || delta.count < 0 || king_moved)
+            {
+                rebuild = true;
+                break;
+            }
+
+            --from;
+        }
+
+        if(rebuild)
+        {
+            NNUE::refresh(*this, p, current.acc);
+        } else
+        {
+            // each ply in between is filled in too, so siblings can start from it
+            int ksq = king_sq(as_color(p));
+
+            for(size_t i = from + 1; i <= ply; ++i)
+            {
+                NNUE::update(nnue_states[i - 1].acc, nnue_states[i].delta, p, ksq, nnue_states[i].acc);
+                nnue_states[i].computed[p] = true;
+            }
+        }
+
+        current.computed[p] = true;
+    }
+
+    return current.acc;
 }
 
 void Board::print(std::ostream& os) const
@@ -873,25 +1325,82 @@ Move Board::from_uci(const std::string& uci) const
     return m;
 }
 
-void Board::generate_pawn_moves(std::vector<Move>& moves) const
+Move Board::decode_move(uint16_t code) const
+{
+    int from = code & 0x3F;
+    int to = (code >> 6) & 0x3F;
+    int promo = code >> 12;
+
+    Move m;
+    m.from = static_cast<uint8_t>(from);
+    m.to = static_cast<uint8_t>(to);
+    m.piece = static_cast<uint8_t>(mailbox[from]);
+    m.capture = static_cast<uint8_t>(mailbox[to] >= 0 ? mailbox[to] : 0xFF);
+    m.promo = 0xFF;
+    m.flags = m.capture != 0xFF ? as_int(MoveFlag::Capture) : as_int(MoveFlag::Quiet);
+
+    if(mailbox[from] < 0)
+        return m;
+
+    int pt = decode_piece(mailbox[from]);
+
+    if(pt == as_int(PieceType::Pawn))
+    {
+        if(promo != 0)
+        {
+            m.promo = static_cast<uint8_t>(promo);
+            m.flags |= as_int(MoveFlag::Promotion);
+        } else if(std::abs(to - from) == 16)
+        {
+            m.flags |= as_int(MoveFlag::DoublePawnPush);
+        } else if(to == en_passant_square && (from & 7) != (to & 7))
+        {
+            m.capture = static_cast<uint8_t>(mailbox[to + (decode_color(mailbox[from]) == 0 ? -8 : 8)]);
+            m.flags = as_int(MoveFlag::EnPassant) | as_int(MoveFlag::Capture);
+        }
+    } else if(pt == as_int(PieceType::King) && std::abs(to - from) == 2)
+    {
+        m.flags = to > from ? as_int(MoveFlag::KingCastle) : as_int(MoveFlag::QueenCastle);
+    }
+
+    return m;
+}
+
+void Board::generate_pawn_moves(MoveList& moves, uint64_t mask, uint64_t pinned, bool noisy, bool quiet) const
 {
     int color = as_int(side_to_move);
     uint64_t pawns = pieces_bb[color][as_int(PieceType::Pawn)];
     uint64_t empty = ~all_pieces_bb;
-    uint64_t enemy_occ = color_bb[color ^ 1];
+    uint64_t enemy_occ = color_bb[color ^ 1] & mask;
+
+    // pinned pawns may only move along the line through their king
+    uint64_t king = pieces_bb[color][as_int(PieceType::King)];
+    int ksq = king ? __builtin_ctzll(king) : 0;
+    auto pin_ok = [&](int from, int to)
+    {
+        return !((pinned >> from) & 1) || ((AttackTables::line[ksq][from] >> to) & 1);
+    };
 
     // single pushes
     uint64_t single = color == 0 ? (pawns << 8) : (pawns >> 8);
-    single &= empty;
+    single &= empty & mask;
+
+    // promotions count as noisy, the rest as quiet
+    if(!noisy)
+        single &= ~promo_ranks;
+    if(!quiet)
+        single &= promo_ranks;
+
     while(single)
     {
         int to = __builtin_ctzll(single);
         single &= single - 1;
 
         int from = to + (color == 0 ? -8 : 8);
+        if(!pin_ok(from, to))
+            continue;
 
-        int rank = to >> 3;
-        if(rank == 7 || rank == 0)
+        if((1ULL << to) & promo_ranks)
         {
             for(auto pt : { PieceType::Queen, PieceType::Rook, PieceType::Bishop, PieceType::Knight})
                 moves.push_back(make_pawn_move(from, to, color, pt, static_cast<uint8_t>(MoveFlag::Promotion)));
@@ -902,18 +1411,25 @@ void Board::generate_pawn_moves(std::vector<Move>& moves) const
     }
 
     // double pushes
-    uint64_t start = pawns & (color == 0 ? rank_2 : rank_7);
+    uint64_t start = quiet ? pawns & (color == 0 ? rank_2 : rank_7) : 0ULL;
     uint64_t one_step = color == 0 ? ((start << 8) & empty) : ((start >> 8) & empty);
     uint64_t dbl = color == 0 ? ((one_step << 8) & empty) : ((one_step >> 8) & empty);
+    dbl &= mask;
     while(dbl)
     {
         int to = __builtin_ctzll(dbl);
         dbl &= dbl - 1;
 
         int from = to + (color == 0 ? -16 : 16);
+        if(!pin_ok(from, to))
+            continue;
+
         moves.push_back(make_pawn_move(from, to, color, PieceType::Pawn, static_cast<uint8_t>(MoveFlag::DoublePawnPush)));
     }
 
+    if(!noisy)
+        return;
+
     // captures
     uint64_t pawns_cp = pawns;
     while(pawns_cp)
@@ -922,6 +1438,9 @@ void Board::generate_pawn_moves(std::vector<Move>& moves) const
         pawns_cp &= pawns_cp - 1;
 
         uint64_t attacks = AttackTables::pawn[color][from] & enemy_occ;
+        if((pinned >> from) & 1)
+            attacks &= AttackTables::line[ksq][from];
+
         while(attacks)
         {
             int to = __builtin_ctzll(attacks);
@@ -951,39 +1470,111 @@ void Board::generate_pawn_moves(std::vector<Move>& moves) const
 
         from_squares &= pawns;
 
+        int cap_sq = en_passant_square + (color == 0 ? -8 : 8);
+        uint64_t cap_mask = 1ULL << cap_sq;
+
         while(from_squares)
         {
             int from = __builtin_ctzll(from_squares);
             from_squares &= from_squares - 1;
+
+            // two pawns leave the board at once, so test the resulting position directly
+            if(king)
+            {
+                uint64_t occ = (all_pieces_bb ^ (1ULL << from) ^ cap_mask) | ep_mask;
+                if(attackers_to(ksq, occ) & color_bb[color ^ 1] & ~cap_mask)
+                    continue;
+            }
+
             moves.push_back(make_pawn_ep(from, en_passant_square, color));
         }
     }
 }
 
-void Board::generate_knight_moves(std::vector<Move>& moves) const
+void Board::generate_knight_moves(MoveList& moves, uint64_t target, uint64_t pinned) const
 {
     int color = as_int(side_to_move);
 
-    uint64_t knights = pieces_bb[color][as_int(PieceType::Knight)];
-    uint64_t me = color_bb[color];
+    // a pinned knight can never move
+    uint64_t knights = pieces_bb[color][as_int(PieceType::Knight)] & ~pinned;
+    uint64_t foe = color_bb[color ^ 1];
     while(knights)
     {
         int from = __builtin_ctzll(knights);
         knights &= knights - 1;
 
-        uint64_t attacks = AttackTables::knight[from] & ~me;
+        uint64_t attacks = AttackTables::knight[from] & target;
         while(attacks)
         {
             int to = __builtin_ctzll(attacks);
             attacks &= attacks - 1;
 
-            bool is_cap = (all_pieces_bb & (1ULL << to)) && ((color_bb[color ^ 1] >> to) & 1);
+            bool is_cap = (foe >> to) & 1;
             moves.push_back(make_piece_move(from, to, color, PieceType::Knight, static_cast<uint8_t>(is_cap ? MoveFlag::Capture : MoveFlag::Quiet), static_cast<uint8_t>(is_cap ? mailbox[to] : 0xFF)));
         }
     }
 }
 
-void Board::generate_king_moves(std::vector<Move>& moves) const
+template<PieceType pt>
+void Board::generate_slider_moves(MoveList& moves, uint64_t target, uint64_t pinned) const
+{
+    int color = as_int(side_to_move);
+
+    uint64_t bb = pieces_bb[color][as_int(pt)];
+    uint64_t foe = color_bb[color ^ 1];
+    int ksq = pinned ? king_sq(side_to_move) : 0;
+    while(bb)
+    {
+        int from = __builtin_ctzll(bb);
+        bb &= bb - 1;
+
+        uint64_t attacks = AttackTables::attacks<pt>(from, all_pieces_bb) & target;
+        if((pinned >> from) & 1)
+            attacks &= AttackTables::line[ksq][from];
+
+        while(attacks)
+        {
+            int to = __builtin_ctzll(attacks);
+            attacks &= attacks - 1;
+
+            bool is_cap = (foe >> to) & 1;
+            moves.push_back(make_piece_move(from, to, color, pt, static_cast<uint8_t>(is_cap ? MoveFlag::Capture : MoveFlag::Quiet), static_cast<uint8_t>(is_cap ? mailbox[to] : 0xFF)));
+        }
+    }
+}
+
+template<PieceType pt>
+void Board::generate_checking_moves(MoveList& moves, uint64_t checks, uint64_t discoverers, int eksq, uint64_t pinned) const
+{
+    int color = as_int(side_to_move);
+
+    uint64_t bb = pieces_bb[color][as_int(pt)];
+    uint64_t empty = ~all_pieces_bb;
+    int ksq = pinned ? king_sq(side_to_move) : 0;
+    while(bb)
+    {
+        int from = __builtin_ctzll(bb);
+        bb &= bb - 1;
+
+        uint64_t target = checks;
+        if((discoverers >> from) & 1)
+            target |= ~AttackTables::line[eksq][from];
+
+        uint64_t attacks = AttackTables::attacks<pt>(from, all_pieces_bb) & target & empty;
+        if((pinned >> from) & 1)
+            attacks &= AttackTables::line[ksq][from];
+
+        while(attacks)
+        {
+            int to = __builtin_ctzll(attacks);
+            attacks &= attacks - 1;
+
+            moves.push_back(make_piece_move(from, to, color, pt, static_cast<uint8_t>(MoveFlag::Quiet), 0xFF));
+        }
+    }
+}
+
+void Board::generate_king_moves(MoveList& moves, uint64_t target, bool legal) const
 {
     int color = as_int(side_to_move);
 
@@ -991,18 +1582,29 @@ void Board::generate_king_moves(std::vector<Move>& moves) const
     if(kings)
     {
         int from = __builtin_ctzll(kings);
-        uint64_t attacks = AttackTables::king[from] & ~color_bb[color];
+
+        // the king must not hide behind itself from a slider
+        uint64_t occ = all_pieces_bb ^ kings;
+
+        uint64_t attacks = AttackTables::king[from] & target;
         while(attacks)
         {
             int to = __builtin_ctzll(attacks);
             attacks &= attacks - 1;
 
+            if(legal && (attackers_to(to, occ) & color_bb[color ^ 1]))
+                continue;
+
             bool isCap = ((color_bb[color ^ 1] >> to) & 1);
             moves.push_back(make_piece_move(from, to, color, PieceType::King, static_cast<uint8_t>(isCap ? MoveFlag::Capture : MoveFlag::Quiet), static_cast<uint8_t>(isCap ? mailbox[to] : 0xFF)));
         }
     }
+}
+
+void Board::generate_castling(MoveList& moves) const
+{
+    int color = as_int(side_to_move);
 
-    // castling
     if(color == as_int(Color::White))
     {
         if((castling_rights & castle_K) && !(all_pieces_bb & ((1ULL << 5) | (1ULL << 6))) && !is_attacked(4, Color::Black) && !is_attacked(5, Color::Black) && !is_attacked(6, Color::Black))
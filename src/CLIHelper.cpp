@@ -1,16 +1,19 @@
 #include "nebula/CLIHelper.hpp"
 
 #include <iostream>
+#include <string>
 #include <getopt.h>
 
 namespace nebula
 {
 
-ReturnCode opts(int argc, char* argv[], InputMode& mode, int& depth, int& length)
+ReturnCode opts(int argc, char* argv[], Options& options)
 {
+    Options parsed = options;
+
     opterr = static_cast<int>(false);
 
-    const char* shortOptions = "hm:d:l:";
+    const char* shortOptions = "hm:d:l:f:t:e:";
 
     option longOptions[] =
     {
@@ -18,6 +21,23 @@ ReturnCode opts(int argc, char* argv[], InputMode& mode, int& depth, int& length
         { "mode", required_argument, nullptr, 'm' },
         { "depth", required_argument, nullptr, 'd' },
         { "length", required_argument, nullptr, 'l' },
+        { "fen", required_argument, nullptr, 'f' },
+        { "threads", required_argument, nullptr, 't' },
+        { "hash", required_argument, nullptr, 's' },
+        { "hash-file", required_argument, nullptr, 'F' },
+        { "divide", no_argument, nullptr, 'D' },
+        { "perft-hash", required_argument, nullptr, 'H' },
+        { "epd", required_argument, nullptr, 'e' },
+        { "movetime", required_argument, nullptr, 'M' },
+        { "wtime", required_argument, nullptr, 'W' },
+        { "btime", required_argument, nullptr, 'B' },
+        { "winc", required_argument, nullptr, 'w' },
+        { "binc", required_argument, nullptr, 'b' },
+        { "nodes", required_argument, nullptr, 'N' },
+        { "eval", required_argument, nullptr, 'E' },
+        { "nnue", required_argument, nullptr, 'n' },
+        { "params", required_argument, nullptr, 'P' },
+        { "baseline", required_argument, nullptr, 'R' },
         { nullptr, 0, nullptr, '\0' }
     };
 
@@ -39,22 +59,96 @@ Required:
         Specify input mode (required):
         PVE    Player vs. Engine (you enter moves)
         EVE    Engine vs. Engine (auto play)
+        PERFT  Count move generation leaf nodes
+        BENCH  Search a fixed set of positions and report NPS
 
 Options:
 -h, --help
         Show this help message and exit.
 
 -d, --depth DEPTH
-        Maximum search depth (positive integer).
-        Default is set to 5.
+        Maximum search depth (positive integer), or perft depth.
+        Default is 8 for search and bench, 5 for perft.
 
 -l, --length LENGTH
         Maximum game length in moves (positive integer).
         Default is unlimited.
 
+-f, --fen FEN
+        Starting position. Default is the standard opening.
+
+-t, --threads N
+        Number of search (or perft) threads (positive integer).
+        Default is 1.
+
+--hash MB
+        Size of the transposition table in MB (any positive size).
+        Default is 16.
+
+--hash-file FILE
+        Keep the transposition table in FILE so it survives restarts.
+        An existing table file is reused as is (its size wins over
+        --hash); a missing or empty FILE gets a new empty table. Any
+        other file is left alone and the hash stays in memory.
+
+Evaluation:
+--eval EVAL
+        classical  Hand-written evaluation (default).
+        nnue       Neural network, loaded from --nnue.
+
+--nnue FILE
+        Network file for --eval nnue. Default is nebula.nnue.
+
+--params FILE
+        Evaluation weights from tuning/scripts/tune_evaluation.py's
+        tuning_results.json, or a JSON object of weights, e.g.
+        { "material_value": [100, 320, 330, 500, 900, 0],
+          "isolated_pawn_penalty": [25, 37] }
+        Names are the EvalParams fields in Values.hpp (or the tuner's
+        base_values for passed_pawn_bonus). Scores take [mg, eg] or
+        the tuner's single value; fields left out keep their built-in
+        values. Needs a build with -DNEBULA_TUNABLE=1.
+
+Search limits (override the default depth of 8 unless -d is given):
+--movetime MS
+        Think for exactly MS milliseconds per move.
+
+--wtime MS, --btime MS, --winc MS, --binc MS
+        Play on a clock: remaining time and increment per move.
+        The engine's clock runs down over the game.
+
+--nodes N
+        Stop each search after about N nodes.
+
+Perft options:
+--divide
+        Print the node count below each root move.
+
+--perft-hash MB
+        Size of the perft hash in MB. Default is 0 (off).
+
+-e, --epd FILE
+        Run an EPD suite of "FEN ;D1 n ;D2 n ..." lines instead
+        of a single position; --depth caps the depths checked.
+        Exits with status 1 if any count is wrong.
+
+Bench options:
+--baseline NPS
+        NPS of another build's bench at the same settings; prints how
+        much faster or slower this build is. Run a build with and one
+        without -DNEBULA_TUNABLE=1 to see what runtime parameters cost.
+
 Examples:
 ./nebula -m PVE --depth 6
 ./nebula --mode EVE -d 8 -l 200
+./nebula -m EVE -d 10 --threads 8 --hash 1024
+./nebula -m EVE -d 12 -l 20 --hash 4096 --hash-file analysis.tt
+./nebula -m EVE -d 10 --eval nnue --nnue nets/nebula.nnue
+./nebula -m EVE --wtime 60000 --btime 60000 --winc 1000 --binc 1000
+./nebula -m BENCH -d 9 --params tuned.json
+./nebula -m BENCH -d 9 --baseline 2465100
+./nebula -m PERFT -d 6 --divide -t 4
+./nebula -m PERFT -e perft/standard.epd --perft-hash 64
 
 )";
 
@@ -64,10 +158,16 @@ Examples:
             case 'm':
                 if(std::string(optarg) == "PVE")
                 {
-                    mode = InputMode::PlayerInput;
+                    parsed.mode = InputMode::PlayerInput;
                 } else if(std::string(optarg) == "EVE")
                 {
-                    mode = InputMode::Auto;
+                    parsed.mode = InputMode::Auto;
+                } else if(std::string(optarg) == "PERFT")
+                {
+                    parsed.mode = InputMode::Perft;
+                } else if(std::string(optarg) == "BENCH")
+                {
+                    parsed.mode = InputMode::Bench;
                 } else
                 {
                     std::cerr << "Invalid mode; try ./nebula --help\n";
@@ -77,11 +177,99 @@ Examples:
                 break;
             
             case 'd':
-                depth = std::stoi(optarg);
+                parsed.depth = std::stoi(optarg);
                 break;
             
             case 'l':
-                length = std::stoi(optarg);
+                parsed.length = std::stoi(optarg);
+                break;
+
+            case 'f':
+                parsed.fen = optarg;
+                break;
+
+            case 't':
+                parsed.threads = std::stoi(optarg);
+                if(parsed.threads < 1)
+                {
+                    std::cerr << "Thread count must be positive; try ./nebula --help\n";
+                    return ReturnCode::Error;
+                }
+                break;
+
+            case 's':
+                parsed.hash_mb = std::stoul(optarg);
+                if(parsed.hash_mb < 1)
+                {
+                    std::cerr << "Hash size must be positive; try ./nebula --help\n";
+                    return ReturnCode::Error;
+                }
+                break;
+
+            case 'F':
+                parsed.hash_file = optarg;
+                break;
+
+            case 'D':
+                parsed.divide = true;
+                break;
+
+            case 'H':
+                parsed.perft_hash_mb = std::stoul(optarg);
+                break;
+
+            case 'e':
+                parsed.epd = optarg;
+                break;
+
+            case 'M':
+                parsed.movetime = std::stoll(optarg);
+                break;
+
+            case 'W':
+                parsed.wtime = std::stoll(optarg);
+                break;
+
+            case 'B':
+                parsed.btime = std::stoll(optarg);
+                break;
+
+            case 'w':
+                parsed.winc = std::stoll(optarg);
+                break;
+
+            case 'b':
+                parsed.binc = std::stoll(optarg);
+                break;
+
+            case 'N':
+                parsed.nodes = std::stoull(optarg);
+                break;
+
+            case 'E':
+                if(std::string(optarg) == "classical")
+                {
+                    parsed.eval = EvalMode::Classical;
+                } else if(std::string(optarg) == "nnue")
+                {
+                    parsed.eval = EvalMode::NNUE;
+                } else
+                {
+                    std::cerr << "Invalid evaluation; try ./nebula --help\n";
+                    return ReturnCode::Error;
+                }
+                break;
+
+            case 'n':
+                parsed.nnue_file = optarg;
+                break;
+
+            case 'P':
+                parsed.params_file = optarg;
+                break;
+
+            case 'R':
+                parsed.baseline_nps = std::stoull(optarg);
                 break;
             
             default:
@@ -96,6 +284,8 @@ Examples:
         return ReturnCode::Error;
     }
 
+    options = parsed;
+
     return ReturnCode::Good;
 }
 
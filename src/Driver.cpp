@@ -1,22 +1,61 @@
 #include "nebula/Driver.hpp"
 #include "nebula/Search.hpp"
+#include "nebula/NNUE.hpp"
 #include "nebula/PGNExporter.hpp"
+#include "nebula/Values.hpp"
+
+#include <chrono>
+#include <iostream>
 
 namespace nebula
 {
 
-void pve(Board& board, int depth, int max_moves)
+// charge the time spent to the mover's clock; returns false if the flag fell
+static bool update_clock(SearchLimits& limits, Color side, int64_t spent)
 {
+    int c = static_cast<int>(side);
+
+    if(limits.time[c] <= 0)
+        return true;
+
+    limits.time[c] -= spent;
+    if(limits.time[c] <= 0)
+        return false;
+
+    limits.time[c] += limits.inc[c];
+
+    return true;
+}
+
+// move the TT into hash_file if one is given, then report what the table ended up on;
+// true if the table lives in the file, so it may be saved there at the end
+static bool open_hash(Search& engine, size_t hash_mb, const std::string& hash_file)
+{
+    std::string error;
+    bool kept = !hash_file.empty() && engine.hash().attach(hash_file, hash_mb * 1024 * 1024, error);
+
+    if(!hash_file.empty() && !kept)
+        std::cerr << "Could not map " << hash_file << ": " << error << "; the hash won't be kept\n";
+
+    std::cout << "Hash: " << engine.hash().describe() << "\n\n";
+
+    return kept;
+}
+
+void pve(Board& board, int depth, int max_moves, int threads, SearchLimits limits, size_t hash_mb, const std::string& hash_file)
+{
+    Search engine(depth, threads, hash_mb);
+    bool keep_hash = open_hash(engine, hash_mb, hash_file);
+
     board.print();
 
-    Search engine(depth);
     PGNExporter wrapper(&board);
 
     for(int i = 0; i < max_moves; ++i)
     {
         if(i % 2 == 0) // player turn
         {
-            std::vector<Move> legal = board.generate_moves();
+            MoveList legal = board.generate_moves();
 
             if(legal.empty())
             {
@@ -67,7 +106,7 @@ void pve(Board& board, int depth, int max_moves)
             }
         } else // engine turn
         {
-            std::vector<Move> legal = board.generate_moves();
+            MoveList legal = board.generate_moves();
 
             if(legal.empty())
             {
@@ -95,7 +134,17 @@ void pve(Board& board, int depth, int max_moves)
             nebula::Move m;
             double eval;
 
-            bool successful = engine.best_move(board, m, eval);
+            auto start = std::chrono::steady_clock::now();
+            bool successful = engine.best_move(board, m, eval, limits);
+            int64_t spent = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+            if(!update_clock(limits, board.turn(), spent))
+            {
+                std::cout << "Engine lost on time.\n\n";
+                wrapper.set_tag("Result", board.turn() == Color::White ? "0-1" : "1-0");
+
+                break;
+            }
 
             if(successful)
             {
@@ -121,19 +170,24 @@ void pve(Board& board, int depth, int max_moves)
         }
     }
 
+    if(keep_hash && !engine.hash().save(hash_file))
+        std::cerr << "Could not save the hash to " << hash_file << '\n';
+
     std::cout << wrapper.out();
 }
 
-void eve(Board& board, int depth, int max_moves)
+void eve(Board& board, int depth, int max_moves, int threads, SearchLimits limits, size_t hash_mb, const std::string& hash_file)
 {
+    Search engine(depth, threads, hash_mb);
+    bool keep_hash = open_hash(engine, hash_mb, hash_file);
+
     board.print();
 
-    Search engine(depth);
     PGNExporter wrapper(&board);
 
     for(int i = 0; i < max_moves; ++i)
     {
-        std::vector<Move> legal = board.generate_moves();
+        MoveList legal = board.generate_moves();
 
         if(legal.empty())
         {
@@ -161,12 +215,25 @@ void eve(Board& board, int depth, int max_moves)
         nebula::Move m;
         double eval;
 
-        bool successful = engine.best_move(board, m, eval);
+        auto start = std::chrono::steady_clock::now();
+        bool successful = engine.best_move(board, m, eval, limits);
+        int64_t spent = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+        if(!update_clock(limits, board.turn(), spent))
+        {
+            std::cout << (board.turn() == Color::White ? "White" : "Black") << " lost on time.\n\n";
+            wrapper.set_tag("Result", board.turn() == Color::White ? "0-1" : "1-0");
+
+            break;
+        }
 
         if(successful)
         {
             std::cout << eval << ": " << m.uci() << '\n';
 
+            if constexpr(SearchStats::enabled)
+                engine.stats().print();
+
             wrapper.make_move(m);
 
             board.print();
@@ -186,7 +253,81 @@ void eve(Board& board, int depth, int max_moves)
         }
     }
 
+    if(keep_hash && !engine.hash().save(hash_file))
+        std::cerr << "Could not save the hash to " << hash_file << '\n';
+
     std::cout << wrapper.out();
 }
 
-}
\ No newline at end of file
+void bench(int depth, int threads, size_t hash_mb, uint64_t baseline_nps)
+{
+    // openings, middlegames and endgames, so every eval term gets exercised
+    static const char* positions[] =
+    {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R1BQKB1R w KQ - 0 8",
+        "2r2rk1/1bqnbppp/p2ppn2/1p6/3NP3/1BN1BP2/PPPQ2PP/2KR3R w - - 0 14",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "8/8/1p1k4/p1p2p2/P1P2P2/1P1K4/8/8 w - - 0 1",
+        "4k3/8/8/8/3PP3/8/8/4K3 w - - 0 1",
+        "3r2k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1"
+    };
+
+    constexpr int count = sizeof(positions) / sizeof(positions[0]);
+
+    Search engine(depth, threads, hash_mb);
+
+    // the parameter mode is fixed at build time, so its cost shows against the other build's NPS
+    std::cout << "Eval: " << (NNUE::enabled() ? "nnue" : "classical");
+    if(NNUE::enabled())
+        std::cout << " (" << NNUE::simd() << ")";
+    std::cout << ", " << (Values::tunable ? "runtime" : "constexpr") << " parameters\n";
+    std::cout << "Depth: " << depth << ", threads: " << threads << ", hash: " << engine.hash().describe() << "\n\n";
+
+    uint64_t total = 0;
+    double seconds = 0.0;
+
+    for(int i = 0; i < count; ++i)
+    {
+        Board board(positions[i]);
+
+        // every position starts cold, so runs are comparable
+        engine.clear();
+
+        Move move;
+        double eval;
+
+        auto start = std::chrono::steady_clock::now();
+        engine.best_move(board, move, eval);
+        double spent = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        uint64_t nodes = engine.stats().nodes;
+        total += nodes;
+        seconds += spent;
+
+        std::cout << "Position " << (i + 1) << '/' << count << ": " << move.uci() << ' ' << eval << ", "
+                  << nodes << " nodes, " << spent * 1000.0 << " ms\n";
+    }
+
+    uint64_t nps = static_cast<uint64_t>(seconds > 0 ? total / seconds : 0);
+
+    std::cout << '\n';
+    std::cout << "Nodes: " << total << '\n';
+    std::cout << "Time: " << seconds * 1000.0 << " ms\n";
+    std::cout << "NPS: " << nps << '\n';
+
+    if(baseline_nps > 0)
+    {
+        double change = 100.0 * (static_cast<double>(nps) - static_cast<double>(baseline_nps)) / static_cast<double>(baseline_nps);
+
+        std::cout << "Baseline: " << baseline_nps << " NPS, " << (change >= 0 ? "+" : "") << change << "% with "
+                  << (Values::tunable ? "runtime" : "constexpr") << " parameters\n";
+    }
+
+    std::cout << '\n';
+}
+
+}
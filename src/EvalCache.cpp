@@ -0,0 +1,25 @@
+#include "nebula/EvalCache.hpp"
+
+#include <cstring>
+
+namespace nebula
+{
+
+EvalCache::EvalCache(size_t entries)
+{
+    size_t size = 1;
+    while(size * 2 <= entries)
+        size *= 2;
+
+    // zero-filled memory is a table of empty entries
+    memory = LargeMemory(size * sizeof(std::atomic<uint64_t>));
+    table = static_cast<std::atomic<uint64_t>*>(memory.data());
+    mask = size - 1;
+}
+
+void EvalCache::clear()
+{
+    std::memset(static_cast<void*>(table), 0, (mask + 1) * sizeof(std::atomic<uint64_t>));
+}
+
+}
@@ -1,337 +1,267 @@
 #include "nebula/Evaluate.hpp"
+#include "nebula/AttackTables.hpp"
+#include "nebula/NNUE.hpp"
 #include "nebula/Values.hpp"
 
+#include <utility>
+
 namespace nebula
 {
 
 int Evaluate::evaluate(const Board& board)
 {
-    int score = 0;
+    // --eval nnue
+    if(NNUE::enabled())
+        return NNUE::evaluate(board);
 
-    // one calculation
-    double phase = phase_of_game(board);
-    
-    score += material(board, phase);
-    score += castling_bonus(board, phase);
-    score += pawn_structure(board, phase);
+    // material and PST are kept up to date by the board
+    Score score = board.eval_state().psq;
+
+    score += castling_bonus(board);
+    score += pawn_structure(board);
+
+    // one interpolation at the end
+    int value = score.blend(phase_of_game(board), Values::max_phase);
     
-    return (board.turn() == Color::White) ? score : -score;
+    return (board.turn() == Color::White) ? value : -value;
 }
 
-int Evaluate::material(const Board& board, double phase)
+int Evaluate::evaluate(const Board& board, int alpha, int beta, bool* exact)
 {
-    int mat = 0;
-    int opening_score = 0;
-    int endgame_score = 0;
+    if(exact)
+        *exact = true;
+
+    // the network has no cheap part to stop after
+    if(NNUE::enabled())
+        return NNUE::evaluate(board);
+
+    int phase = phase_of_game(board);
+
+    Score cheap = board.eval_state().psq + castling_bonus(board);
+    int value = cheap.blend(phase, Values::max_phase);
 
-    for(int piece = 0; piece < Board::num_piece_types; ++piece)
+    int up, down;
+    pawn_structure_bounds(board, phase, up, down);
+
+    // side to move's point of view
+    if(board.turn() == Color::Black)
     {
-        PieceType pt = static_cast<PieceType>(piece);
-        
-        // white pieces
-        uint64_t white_pieces = board.pieces(Color::White, pt);
-        while(white_pieces)
-        {
-            int sq = __builtin_ctzll(white_pieces);
-            mat += Values::material_value[piece];
-            opening_score += Values::pst[piece][sq];
-            endgame_score += Values::pst_endgame[piece][sq];
-            white_pieces &= white_pieces - 1;
-        }
-        
-        // black pieces
-        uint64_t black_pieces = board.pieces(Color::Black, pt);
-        while(black_pieces)
-        {
-            int sq = __builtin_ctzll(black_pieces);
-            mat -= Values::material_value[piece];
-            // mirror PST scores vertically
-            opening_score -= Values::pst[piece][sq ^ 56];
-            endgame_score -= Values::pst[piece][sq ^ 56];
-            black_pieces &= black_pieces - 1;
-        }
+        value = -value;
+        std::swap(up, down);
     }
 
-    int blended_pst = static_cast<int>(opening_score * phase + endgame_score * (1.0 - phase));
+    if(value + up <= alpha || value - down >= beta)
+    {
+        if(exact)
+            *exact = false;
+
+        return value + up <= alpha ? value + up : value - down;
+    }
 
-    return mat + blended_pst;
+    return evaluate(board);
 }
 
-int Evaluate::castling_bonus(const Board& board, double phase)
+Score Evaluate::castling_bonus(const Board& board)
 {
-    int bonus = 0;
+    Score bonus;
 
     // castling rights bonus
     if(board.castling() & (board.castle_K | board.castle_Q))
-        bonus += Values::castle_rights_bonus;
+        bonus += Values::params.castle_rights_bonus;
     if(board.castling() & (board.castle_k | board.castle_q))
-        bonus -= Values::castle_rights_bonus;
+        bonus -= Values::params.castle_rights_bonus;
 
     // detect castled position
     int wk = board.king_sq(Color::White);
     if(wk == 6 || wk == 2)
-        bonus += Values::castled_position_bonus;
+        bonus += Values::params.castled_position_bonus;
     int bk = board.king_sq(Color::Black);
     if(bk == 62 || bk == 58)
-        bonus -= Values::castled_position_bonus;
-
-    // blend by opening phase
-    bonus = static_cast<int>(bonus * phase);
+        bonus -= Values::params.castled_position_bonus;
 
     return bonus;
 }
 
-int Evaluate::pawn_structure(const Board& board, double phase)
+Score Evaluate::pawn_structure(const Board& board)
 {
-    int score = 0;
-    
-    // weaknesses for each color
-    score += analyze_pawn_weaknesses(board, Color::White, phase);
-    score -= analyze_pawn_weaknesses(board, Color::Black, phase);
-    
-    // passed pawns for each color
-    score += analyze_passed_pawns(board, Color::White, phase);
-    score -= analyze_passed_pawns(board, Color::Black, phase);
-    
-    return score;
+    return probe_pawns(board).score;
 }
 
-int Evaluate::analyze_pawn_weaknesses(const Board& board, Color color, double phase)
+// the parts of a term above and below zero, mg and eg separately; tuned terms can have either sign
+static Score above_zero(Score s)
 {
-    int penalty = 0;
-    uint64_t pawns = board.pieces(color, PieceType::Pawn);
-    
-    // pawns per file
-    std::array<int, 8> file_counts = { 0 };
-    uint64_t temp_pawns = pawns;
+    return Score(std::max(0, s.mg()), std::max(0, s.eg()));
+}
 
-    while(temp_pawns)
-    {
-        int sq = __builtin_ctzll(temp_pawns);
+static Score below_zero(Score s)
+{
+    return Score(std::max(0, -s.mg()), std::max(0, -s.eg()));
+}
 
-        ++file_counts[sq & 7];
+void Evaluate::pawn_structure_bounds(const Board& board, int phase, int& up, int& down)
+{
+    const PawnEntry& entry = probe_pawns(board);
 
-        temp_pawns &= temp_pawns - 1;
-    }
-    
-    // score for each pawn
-    temp_pawns = pawns;
-    while(temp_pawns)
+    // blending the pawn terms together with the rest can round up to 2 differently
+    up = entry.most.blend(phase, Values::max_phase) + 2;
+    down = -entry.least.blend(phase, Values::max_phase) + 2;
+}
+
+void Evaluate::pawn_score_range(const Board& board, const uint64_t passed[2], Score& most, Score& least)
+{
+    // every pawn could be isolated, doubled and backward at once, or none of them
+    const Score weak_costs = above_zero(Values::params.isolated_pawn_penalty) + above_zero(Values::params.doubled_pawn_penalty) + above_zero(Values::params.backward_pawn_penalty);
+    const Score weak_gains = below_zero(Values::params.isolated_pawn_penalty) + below_zero(Values::params.doubled_pawn_penalty) + below_zero(Values::params.backward_pawn_penalty);
+
+    // passers are cheap to find set-wise, so their rank bonuses are exact; any of them could be
+    // connected and protected, or neither
+    const Score support_gains = above_zero(Values::params.connected_passed_pawn_bonus) + above_zero(Values::params.protected_passed_pawn_bonus);
+    const Score support_costs = below_zero(Values::params.connected_passed_pawn_bonus) + below_zero(Values::params.protected_passed_pawn_bonus);
+
+    Score ranks[2];
+    int passers[2];
+
+    for(int c = 0; c < 2; ++c)
     {
-        int sq = __builtin_ctzll(temp_pawns);
+        uint64_t bits = passed[c];
 
-        int file = sq & 7;
-        
-        // isolated pawn penalty
-        if(is_isolated_pawn(board, color, file))
+        passers[c] = __builtin_popcountll(bits);
+
+        while(bits)
         {
-            int isolated_penalty = Values::isolated_pawn_penalty;
+            int sq = __builtin_ctzll(bits);
+            ranks[c] += passed_pawn_value(c == 0 ? (sq >> 3) : 7 - (sq >> 3));
 
-            // even worse in endgame
-            isolated_penalty = static_cast<int>(isolated_penalty * (1.0 + (1.0 - phase) * 0.5));
-            
-            penalty += isolated_penalty;
+            bits &= bits - 1;
         }
-        
-        // doubled pawn penalty
-        if(file_counts[file] > 1)
-            penalty += Values::doubled_pawn_penalty;
-        
-        // backward pawn penalty
-        if(is_backward_pawn(board, color, sq))
-            penalty += Values::backward_pawn_penalty;
-        
-        temp_pawns &= temp_pawns - 1;
     }
-    
-    return -penalty; //  these are penalties
-}
 
-int Evaluate::analyze_passed_pawns(const Board& board, Color color, double phase)
-{
-    int bonus = 0;
-    uint64_t pawns = board.pieces(color, PieceType::Pawn);
-    
-    while(pawns)
-    {
-        int sq = __builtin_ctzll(pawns);
-        
-        if(is_passed_pawn(board, color, sq)) {
-            int rank = (color == Color::White) ? (sq >> 3) : (7 - (sq >> 3));
-            bonus += passed_pawn_value(rank, phase);
-            
-            // additional bonuses for advanced passed pawns
-            if(rank >= 5)
-            {
-                // check if pawn is connected to other pawns
-                uint64_t adjacent_files = 0;
-                int file = sq & 7;
-                if(file > 0)
-                    adjacent_files |= board.pieces(color, PieceType::Pawn) & (0x0101010101010101ULL << (file - 1));
-                if(file < 7)
-                    adjacent_files |= board.pieces(color, PieceType::Pawn) & (0x0101010101010101ULL << (file + 1));
-                
-                if(adjacent_files)
-                    bonus += Values::connected_passed_pawn_bonus;
-                
-                // check if pawn is protected by another pawn
-                uint64_t protection_mask = (color == Color::White) ? ((1ULL << (sq - 7)) | (1ULL << (sq - 9))) : ((1ULL << (sq + 7)) | (1ULL << (sq + 9)));
-                
-                if(board.pieces(color, PieceType::Pawn) & protection_mask)
-                    bonus += Values::protected_passed_pawn_bonus;
-            }
-        }
-        
-        pawns &= pawns - 1;
-    }
-    
-    return bonus;
+    int white = __builtin_popcountll(board.pieces(Color::White, PieceType::Pawn));
+    int black = __builtin_popcountll(board.pieces(Color::Black, PieceType::Pawn));
+
+    most = ranks[0] - ranks[1] + support_gains * passers[0] + support_costs * passers[1] + weak_gains * white + weak_costs * black;
+    least = ranks[0] - ranks[1] - support_costs * passers[0] - support_gains * passers[1] - weak_costs * white - weak_gains * black;
 }
 
-bool Evaluate::is_isolated_pawn(const Board& board, Color color, int file)
+PawnHash& Evaluate::pawn_hash()
 {
-    // check adjacent files for friendly pawns
-    uint64_t adjacent_files = 0;
-    if(file > 0)
-        adjacent_files |= board.pieces(color, PieceType::Pawn) & (0x0101010101010101ULL << (file - 1));
-    if(file < 7)
-        adjacent_files |= board.pieces(color, PieceType::Pawn) & (0x0101010101010101ULL << (file + 1));
-    
-    return adjacent_files == 0;
+    static thread_local PawnHash table;
+
+    return table;
 }
 
-bool Evaluate::is_doubled_pawn(const Board& board, Color color, int file)
+void Evaluate::clear_pawn_hash()
 {
-    uint64_t file_pawns = board.pieces(color, PieceType::Pawn) & (0x0101010101010101ULL << file);
-    
-    return __builtin_popcountll(file_pawns) > 1;
+    pawn_hash().clear();
 }
 
-bool Evaluate::is_backward_pawn(const Board& board, Color color, int square)
+const PawnEntry& Evaluate::probe_pawns(const Board& board)
 {
-    int file = square & 7;
-    int rank = square >> 3;
-    
-    // check if pawn can be supported by adjacent pawns
-    bool can_be_supported = false;
-    
-    // left file
-    if(file > 0)
-    {
-        uint64_t left_file_pawns = board.pieces(color, PieceType::Pawn) & (0x0101010101010101ULL << (file - 1));
-        while(left_file_pawns)
-        {
-            int pawn_sq = __builtin_ctzll(left_file_pawns);
-
-            int pawn_rank = pawn_sq >> 3;
-            
-            if(color == Color::White && pawn_rank <= rank)
-                can_be_supported = true;
-            if(color == Color::Black && pawn_rank >= rank)
-                can_be_supported = true;
-            
-            left_file_pawns &= left_file_pawns - 1;
-        }
-    }
-    
-    // right file
-    if(file < 7)
+    uint64_t key = board.pawn_key();
+    PawnEntry& entry = pawn_hash().entry(key);
+
+    // the low bits already picked the slot
+    uint32_t check = static_cast<uint32_t>(key >> 32);
+
+    if(entry.check != check)
     {
-        uint64_t right_file_pawns = board.pieces(color, PieceType::Pawn) & (0x0101010101010101ULL << (file + 1));
-        while(right_file_pawns)
-        {
-            int pawn_sq = __builtin_ctzll(right_file_pawns);
-
-            int pawn_rank = pawn_sq >> 3;
-            
-            if(color == Color::White && pawn_rank <= rank)
-                can_be_supported = true;
-            if(color == Color::Black && pawn_rank >= rank)
-                can_be_supported = true;
-            
-            right_file_pawns &= right_file_pawns - 1;
-        }
+        entry.check = check;
+        entry.passed[static_cast<int>(Color::White)] = passed_pawns(board, Color::White);
+        entry.passed[static_cast<int>(Color::Black)] = passed_pawns(board, Color::Black);
+        entry.score = evaluate_pawns(board, entry.passed);
+        pawn_score_range(board, entry.passed, entry.most, entry.least);
     }
+
+    return entry;
+}
+
+Score Evaluate::evaluate_pawns(const Board& board, const uint64_t passed[2])
+{
+    Score score;
     
-    // check if square in front is controlled by enemy pawn
-    bool blocked_by_enemy = false;
-    int front_sq = (color == Color::White) ? square + 8 : square - 8;
+    // weaknesses for each color
+    score += analyze_pawn_weaknesses(board, Color::White);
+    score -= analyze_pawn_weaknesses(board, Color::Black);
     
-    if(front_sq >= 0 && front_sq < 64)
-    {
-        uint64_t enemy_pawn_attacks = 0;
-        if(color == Color::White)
-        {
-            // check for black pawn attacks
-            if((front_sq & 7) > 0)
-                enemy_pawn_attacks |= (1ULL << (front_sq + 7));
-            if((front_sq & 7) < 7)
-                enemy_pawn_attacks |= (1ULL << (front_sq + 9));
-        } else
-        {
-            // check for white pawn attacks
-            if((front_sq & 7) > 0)
-                enemy_pawn_attacks |= (1ULL << (front_sq - 9));
-            if((front_sq & 7) < 7)
-                enemy_pawn_attacks |= (1ULL << (front_sq - 7));
-        }
-        
-        blocked_by_enemy = (board.pieces(color == Color::White ? Color::Black : Color::White, PieceType::Pawn) & enemy_pawn_attacks) != 0;
-    }
+    // passed pawns for each color
+    score += analyze_passed_pawns(board, Color::White, passed[static_cast<int>(Color::White)]);
+    score -= analyze_passed_pawns(board, Color::Black, passed[static_cast<int>(Color::Black)]);
     
-    return !can_be_supported && blocked_by_enemy;
+    return score;
 }
 
-bool Evaluate::is_passed_pawn(const Board& board, Color color, int square)
+Score Evaluate::analyze_pawn_weaknesses(const Board& board, Color color)
 {
-    int file = square & 7;
-    int rank = square >> 3;
-    
-    // passed pawn zone: file and adjacent files ahead of the pawn
-    uint64_t passed_zone = 0;
+    Color them = (color == Color::White) ? Color::Black : Color::White;
+
+    uint64_t pawns = board.pieces(color, PieceType::Pawn);
+    uint64_t enemy = board.pieces(them, PieceType::Pawn);
+
+    // no friendly pawn on either neighbouring file
+    uint64_t isolated = pawns & ~AttackTables::adjacent(AttackTables::file_fill(pawns));
+
+    // another friendly pawn ahead or behind on the same file
+    uint64_t doubled = pawns & (AttackTables::front_span(Color::White, pawns) | AttackTables::front_span(Color::Black, pawns));
+
+    // no friendly pawn level or behind on a neighbouring file, and the stop square is attacked by an enemy pawn
+    uint64_t supported = AttackTables::adjacent(color == Color::White ? AttackTables::north_fill(pawns) : AttackTables::south_fill(pawns));
+    uint64_t enemy_attacks = AttackTables::pawn_attacks(them, enemy);
+    uint64_t backward = pawns & ~supported & (color == Color::White ? enemy_attacks >> 8 : enemy_attacks << 8);
+
+    Score penalty = Values::params.isolated_pawn_penalty * __builtin_popcountll(isolated)
+                  + Values::params.doubled_pawn_penalty * __builtin_popcountll(doubled)
+                  + Values::params.backward_pawn_penalty * __builtin_popcountll(backward);
     
-    if(color == Color::White)
-    {
-        // check ranks ahead
-        for(int r = rank + 1; r < 8; r++)
-        {
-            if(file > 0)
-                passed_zone |= (1ULL << (r * 8 + file - 1));
+    return -penalty; //  these are penalties
+}
+
+Score Evaluate::analyze_passed_pawns(const Board& board, Color color, uint64_t passed)
+{
+    Score bonus;
+    uint64_t pawns = board.pieces(color, PieceType::Pawn);
 
-            passed_zone |= (1ULL << (r * 8 + file));
+    // relative ranks 6 to 8
+    uint64_t advanced = passed & (color == Color::White ? 0xFFFFFF0000000000ULL : 0x0000000000FFFFFFULL);
 
-            if(file < 7)
-                passed_zone |= (1ULL << (r * 8 + file + 1));
-        }
-    } else
+    // additional bonuses for advanced passed pawns next to or defended by another pawn
+    bonus += Values::params.connected_passed_pawn_bonus * __builtin_popcountll(advanced & AttackTables::adjacent(AttackTables::file_fill(pawns)));
+    bonus += Values::params.protected_passed_pawn_bonus * __builtin_popcountll(advanced & AttackTables::pawn_attacks(color, pawns));
+
+    // rank bonus; there are rarely more than one or two passers
+    while(passed)
     {
-        // check ranks ahead
-        for(int r = rank - 1; r >= 0; r--)
-        {
-            if(file > 0)
-                passed_zone |= (1ULL << (r * 8 + file - 1));
+        int sq = __builtin_ctzll(passed);
 
-            passed_zone |= (1ULL << (r * 8 + file));
-            
-            if(file < 7)
-                passed_zone |= (1ULL << (r * 8 + file + 1));
-        }
+        int rank = (color == Color::White) ? (sq >> 3) : (7 - (sq >> 3));
+        bonus += passed_pawn_value(rank);
+
+        passed &= passed - 1;
     }
     
-    // check if any enemy pawns are in the passed zone
-    uint64_t enemy_pawns = board.pieces(color == Color::White ? Color::Black : Color::White, PieceType::Pawn);
-    
-    return (enemy_pawns & passed_zone) == 0;
+    return bonus;
 }
 
-int Evaluate::passed_pawn_value(int rank, double phase)
+uint64_t Evaluate::passed_pawns(const Board& board, Color color)
+{
+    Color them = (color == Color::White) ? Color::Black : Color::White;
+
+    // squares ahead of, or diagonally ahead of, an enemy pawn from its own side
+    uint64_t span = AttackTables::front_span(them, board.pieces(them, PieceType::Pawn));
+
+    return board.pieces(color, PieceType::Pawn) & ~(span | AttackTables::adjacent(span));
+}
+
+bool Evaluate::is_passed_pawn(const Board& board, Color color, int square)
+{
+    Color them = (color == Color::White) ? Color::Black : Color::White;
+
+    return (board.pieces(them, PieceType::Pawn) & AttackTables::passed_mask[static_cast<int>(color)][square]) == 0;
+}
+
+Score Evaluate::passed_pawn_value(int rank)
 {
-    int base_value = Values::base_values[rank];
-    
     // more valuable in endgame
-    double endgame_multiplier = 1.0 + (1.0 - phase) * 1.5;
-    
-    return static_cast<int>(base_value * endgame_multiplier);
+    return Values::params.passed_pawn_bonus[rank];
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "nebula/LargeMemory.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nebula
+{
+
+#ifdef MADV_HUGEPAGE
+// "never" in the kernel setting makes the advice a no-op
+static bool transparent_huge_pages_enabled()
+{
+    std::ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string setting;
+
+    return !std::getline(in, setting) || setting.find("[never]") == std::string::npos;
+}
+#endif
+
+LargeMemory::LargeMemory(size_t size):
+    bytes(size)
+{
+    if(bytes == 0)
+        return;
+
+#if defined(__unix__) || defined(__APPLE__)
+    // below one huge page, rounding up would waste most of it; the heap is enough
+    if(bytes >= huge_page_size)
+    {
+        size_t rounded = (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+        void* p = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+        // explicit huge pages only exist if the admin reserved some
+        p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(p != MAP_FAILED)
+        {
+            ptr = p;
+            mapped = rounded;
+            page_kind = Pages::Huge;
+
+            return;
+        }
+#endif
+
+        // over-map so a huge page aligned start can be carved out, then trim both ends
+        size_t length = rounded + huge_page_size;
+        p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(p != MAP_FAILED)
+        {
+            char* base = static_cast<char*>(p);
+            char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(base) + huge_page_size - 1) & ~(huge_page_size - 1));
+
+            if(aligned > base)
+                munmap(base, aligned - base);
+            if(base + length > aligned + rounded)
+                munmap(aligned + rounded, base + length - (aligned + rounded));
+
+            ptr = aligned;
+            mapped = rounded;
+            page_kind = Pages::Normal;
+
+#ifdef MADV_HUGEPAGE
+            if(madvise(ptr, mapped, MADV_HUGEPAGE) == 0 && transparent_huge_pages_enabled())
+                page_kind = Pages::Transparent;
+#endif
+
+            return;
+        }
+    }
+#endif
+
+    // small blocks, or no mmap: aligned heap memory, zeroed by hand
+    size_t padded = (bytes + 63) / 64 * 64;
+    ptr = std::aligned_alloc(64, padded);
+    if(!ptr)
+        throw std::bad_alloc();
+
+    std::memset(ptr, 0, padded);
+}
+
+LargeMemory LargeMemory::map_file(const std::string& path, size_t size, bool shared)
+{
+    LargeMemory m;
+
+#if defined(__unix__) || defined(__APPLE__)
+    if(size == 0)
+        return m;
+
+    int fd = open(path.c_str(), shared ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if(fd < 0)
+        return m;
+
+    // growing leaves a sparse tail that reads as zeros
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (static_cast<size_t>(st.st_size) < size && (!shared || ftruncate(fd, static_cast<off_t>(size)) != 0)))
+    {
+        close(fd);
+        return m;
+    }
+
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+
+    // the mapping keeps the file referenced
+    close(fd);
+
+    if(p == MAP_FAILED)
+        return m;
+
+    m.ptr = p;
+    m.bytes = size;
+    m.mapped = size;
+    m.page_kind = Pages::File;
+#else
+    (void)path;
+    (void)size;
+    (void)shared;
+#endif
+
+    return m;
+}
+
+size_t LargeMemory::file_size(const std::string& path)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat st;
+
+    return stat(path.c_str(), &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+#else
+    (void)path;
+
+    return 0;
+#endif
+}
+
+bool LargeMemory::sync() const
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if(page_kind == Pages::File && ptr)
+        return msync(ptr, mapped, MS_SYNC) == 0;
+#endif
+
+    return true;
+}
+
+LargeMemory::~LargeMemory()
+{
+    release();
+}
+
+LargeMemory::LargeMemory(LargeMemory&& other) noexcept:
+    ptr(std::exchange(other.ptr, nullptr)), bytes(std::exchange(other.bytes, 0)), mapped(std::exchange(other.mapped, 0)), page_kind(other.page_kind) {}
+
+LargeMemory& LargeMemory::operator=(LargeMemory&& other) noexcept
+{
+    if(this != &other)
+    {
+        release();
+
+        ptr = std::exchange(other.ptr, nullptr);
+        bytes = std::exchange(other.bytes, 0);
+        mapped = std::exchange(other.mapped, 0);
+        page_kind = other.page_kind;
+    }
+
+    return *this;
+}
+
+std::string LargeMemory::describe() const
+{
+    std::string s = std::to_string(bytes / (1024 * 1024)) + " MB, ";
+
+    switch(page_kind)
+    {
+        case Pages::Huge:
+            return s + "2 MB huge pages";
+
+        case Pages::Transparent:
+            return s + "2 MB transparent huge pages";
+
+        case Pages::File:
+            return s + "mapped from file";
+
+        case Pages::Normal:
+            break;
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    if(mapped)
+        return s + std::to_string(sysconf(_SC_PAGESIZE) / 1024) + " KB pages";
+#endif
+
+    return s + "heap allocation";
+}
+
+void LargeMemory::release()
+{
+    if(!ptr)
+        return;
+
+#if defined(__unix__) || defined(__APPLE__)
+    if(mapped)
+        munmap(ptr, mapped);
+    else
+        std::free(ptr);
+#else
+    std::free(ptr);
+#endif
+
+    ptr = nullptr;
+    bytes = 0;
+    mapped = 0;
+}
+
+}
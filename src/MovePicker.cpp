@@ -0,0 +1,251 @@
+#include "nebula/MovePicker.hpp"
+#include "nebula/Search.hpp"
+#include "nebula/Values.hpp"
+
+#include <utility>
+
+namespace nebula
+{
+
+MovePicker::MovePicker(const Board& board, const SearchWorker& search, const Move* tt, const std::array<Move, 2>* killer_moves):
+    board(board), search(search), tt_move{}, has_tt_move(false), killers{}, killer_index(0), current(0)
+{
+    if(killer_moves)
+        killers = *killer_moves;
+
+    // only trust the TT move if it can actually be played here
+    if(tt && board.is_pseudo_legal(*tt) && board.is_legal(*tt))
+    {
+        tt_move = *tt;
+        has_tt_move = true;
+    }
+
+    if(board.in_check())
+        stage = has_tt_move ? Stage::TTMove : Stage::GenEvasions;
+    else
+        stage = has_tt_move ? Stage::TTMove : Stage::GenCaptures;
+}
+
+MovePicker::MovePicker(const Board& board, const SearchWorker& search):
+    board(board), search(search), tt_move{}, has_tt_move(false), killers{}, killer_index(0), current(0)
+{
+    stage = board.in_check() ? Stage::GenEvasions : Stage::QGenCaptures;
+}
+
+bool MovePicker::next(Move& out)
+{
+    while(true)
+    {
+        switch(stage)
+        {
+            case Stage::TTMove:
+                stage = board.in_check() ? Stage::GenEvasions : Stage::GenCaptures;
+                out = tt_move;
+                return true;
+
+            case Stage::GenCaptures:
+                moves = board.generate_captures();
+                current = 0;
+                score_captures();
+                stage = Stage::Captures;
+                break;
+
+            case Stage::Captures:
+                while(current < moves.size())
+                {
+                    const Move& m = select_best();
+                    ++current;
+
+                    if(has_tt_move && m == tt_move)
+                        continue;
+
+                    out = m;
+                    return true;
+                }
+                stage = Stage::Killers;
+                break;
+
+            case Stage::Killers:
+                while(killer_index < 2)
+                {
+                    const Move& k = killers[killer_index++];
+
+                    // killers come from sibling nodes, so they have to be validated here
+                    if(k.flags & (static_cast<uint8_t>(MoveFlag::Capture) | static_cast<uint8_t>(MoveFlag::Promotion)))
+                        continue;
+                    if(has_tt_move && k == tt_move)
+                        continue;
+                    if(killer_index == 2 && k == killers[0])
+                        continue;
+                    if(!board.is_pseudo_legal(k) || !board.is_legal(k))
+                        continue;
+
+                    out = k;
+                    return true;
+                }
+                stage = Stage::GenQuiets;
+                break;
+
+            case Stage::GenQuiets:
+                moves = board.generate_quiets();
+                current = 0;
+                score_quiets();
+                stage = Stage::Quiets;
+                break;
+
+            case Stage::Quiets:
+                while(current < moves.size())
+                {
+                    const Move& m = select_best();
+                    ++current;
+
+                    if(is_special(m))
+                        continue;
+
+                    out = m;
+                    return true;
+                }
+                stage = Stage::Done;
+                break;
+
+            case Stage::GenEvasions:
+                moves = board.generate_evasions();
+                current = 0;
+                score_evasions();
+                stage = Stage::Evasions;
+                break;
+
+            case Stage::Evasions:
+                while(current < moves.size())
+                {
+                    const Move& m = select_best();
+                    ++current;
+
+                    if(has_tt_move && m == tt_move)
+                        continue;
+
+                    out = m;
+                    return true;
+                }
+                stage = Stage::Done;
+                break;
+
+            case Stage::QGenCaptures:
+                moves = board.generate_captures();
+                current = 0;
+                score_captures();
+                stage = Stage::QCaptures;
+                break;
+
+            case Stage::QCaptures:
+                if(current < moves.size())
+                {
+                    out = select_best();
+                    ++current;
+                    return true;
+                }
+                stage = Stage::QGenChecks;
+                break;
+
+            case Stage::QGenChecks:
+                moves = board.generate_quiet_checks();
+                current = 0;
+                score_quiets();
+                stage = Stage::QChecks;
+                break;
+
+            case Stage::QChecks:
+                if(current < moves.size())
+                {
+                    out = select_best();
+                    ++current;
+                    return true;
+                }
+                stage = Stage::Done;
+                break;
+
+            case Stage::Done:
+                return false;
+        }
+    }
+}
+
+void MovePicker::score_captures()
+{
+    for(int i = 0; i < moves.size(); ++i)
+    {
+        const Move& m = moves[i];
+        int score = 0;
+
+        // most valuable victim - least valuable attacker
+        if(m.capture != 0xFF)
+            score += Values::params.material_value[m.capture & 0b111] - Values::params.material_value[m.piece & 0b111] / 10;
+
+        // promotions
+        if(m.promo != 0xFF)
+            score += Values::params.material_value[m.promo];
+
+        moves.score(i) = score;
+    }
+}
+
+void MovePicker::score_quiets()
+{
+    Color c = board.turn();
+
+    for(int i = 0; i < moves.size(); ++i)
+    {
+        const Move& m = moves[i];
+        int score = search.get_history_score(m, c);
+
+        // castling moves
+        if(m.flags & (static_cast<uint8_t>(MoveFlag::KingCastle) | static_cast<uint8_t>(MoveFlag::QueenCastle)))
+            score += 25;
+
+        moves.score(i) = score;
+    }
+}
+
+void MovePicker::score_evasions()
+{
+    Color c = board.turn();
+
+    for(int i = 0; i < moves.size(); ++i)
+    {
+        const Move& m = moves[i];
+
+        // captures of the checker first, then by history
+        if(m.capture != 0xFF || m.promo != 0xFF)
+            moves.score(i) = 1000000 + (m.capture != 0xFF ? Values::params.material_value[m.capture & 0b111] - Values::params.material_value[m.piece & 0b111] / 10 : 0);
+        else
+            moves.score(i) = search.get_history_score(m, c);
+    }
+}
+
+const Move& MovePicker::select_best()
+{
+    // selection sort step; cheaper than sorting when a cutoff comes early
+    int best = current;
+    for(int i = current + 1; i < moves.size(); ++i)
+        if(moves.score(i) > moves.score(best))
+            best = i;
+
+    if(best != current)
+    {
+        std::swap(moves[best], moves[current]);
+        std::swap(moves.score(best), moves.score(current));
+    }
+
+    return moves[current];
+}
+
+bool MovePicker::is_special(const Move& m) const
+{
+    if(has_tt_move && m == tt_move)
+        return true;
+
+    // killers are only yielded when legal, so a quiet equal to one was already searched
+    return m == killers[0] || m == killers[1];
+}
+
+}
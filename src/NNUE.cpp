@@ -0,0 +1,307 @@
+#include "nebula/NNUE.hpp"
+#include "nebula/Board.hpp"
+#include "nebula/LargeMemory.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+// the x86 kernels carry their own target attributes, so they build without -mavx2/-mssse3
+// and are only called when the CPU has the instructions
+#if NEBULA_NNUE_SIMD && (defined(__x86_64__) || defined(__i386__))
+#define NEBULA_NNUE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace nebula
+{
+
+// weights as they sit in the file after the header
+struct Network
+{
+    alignas(64) int16_t ft_bias[NNUE::hidden];
+    alignas(64) int16_t ft_weights[NNUE::inputs][NNUE::hidden];
+    alignas(64) int8_t out_weights[2 * NNUE::hidden]; // side to move's half first
+    int32_t out_bias;
+};
+
+struct FileHeader
+{
+    char magic[8]; // "NEBULANN"
+    uint32_t version;
+    uint32_t hidden;
+};
+
+static constexpr uint32_t file_version = 1;
+
+// ~20 MB, so it goes where the hash tables go
+static LargeMemory network_memory;
+static const Network* network = nullptr;
+
+bool NNUE::active = false;
+
+// acc = prev + rows in add - rows in sub
+static void apply_scalar(const int16_t* prev, const int16_t* const* add, int adds, const int16_t* const* sub, int subs, int16_t* acc)
+{
+    for(int i = 0; i < NNUE::hidden; ++i)
+    {
+        int v = prev[i];
+
+        for(int a = 0; a < adds; ++a)
+            v += add[a][i];
+        for(int s = 0; s < subs; ++s)
+            v -= sub[s][i];
+
+        acc[i] = static_cast<int16_t>(v);
+    }
+}
+
+// clipped ReLU of one accumulator half dotted with its output weights
+static int32_t output_dot_scalar(const int16_t* acc, const int8_t* weights)
+{
+    int32_t sum = 0;
+
+    for(int i = 0; i < NNUE::hidden; ++i)
+    {
+        int a = acc[i] < 0 ? 0 : (acc[i] > NNUE::activation_max ? NNUE::activation_max : acc[i]);
+
+        sum += a * weights[i];
+    }
+
+    return sum;
+}
+
+#if defined(NEBULA_NNUE_X86)
+__attribute__((target("avx2")))
+static void apply_avx2(const int16_t* prev, const int16_t* const* add, int adds, const int16_t* const* sub, int subs, int16_t* acc)
+{
+    for(int i = 0; i < NNUE::hidden; i += 16)
+    {
+        __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(prev + i));
+
+        for(int a = 0; a < adds; ++a)
+            v = _mm256_add_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(add[a] + i)));
+        for(int s = 0; s < subs; ++s)
+            v = _mm256_sub_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(sub[s] + i)));
+
+        _mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), v);
+    }
+}
+
+__attribute__((target("avx2")))
+static int32_t output_dot_avx2(const int16_t* acc, const int8_t* weights)
+{
+    const __m256i max = _mm256_set1_epi8(NNUE::activation_max);
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+
+    for(int i = 0; i < NNUE::hidden; i += 32)
+    {
+        __m256i lo = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i hi = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i + 16));
+
+        // saturate to [0, 255], clip to 127, then undo the per-lane interleave of packus
+        __m256i act = _mm256_min_epu8(_mm256_packus_epi16(lo, hi), max);
+        act = _mm256_permute4x64_epi64(act, 0xD8);
+
+        // u8 x i8 pairs fit in int16 since 2 * 127 * 127 < 32768
+        __m256i prod = _mm256_maddubs_epi16(act, _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(prod, ones));
+    }
+
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+
+    return _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("ssse3")))
+static void apply_ssse3(const int16_t* prev, const int16_t* const* add, int adds, const int16_t* const* sub, int subs, int16_t* acc)
+{
+    for(int i = 0; i < NNUE::hidden; i += 8)
+    {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(prev + i));
+
+        for(int a = 0; a < adds; ++a)
+            v = _mm_add_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(add[a] + i)));
+        for(int s = 0; s < subs; ++s)
+            v = _mm_sub_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(sub[s] + i)));
+
+        _mm_store_si128(reinterpret_cast<__m128i*>(acc + i), v);
+    }
+}
+
+__attribute__((target("ssse3")))
+static int32_t output_dot_ssse3(const int16_t* acc, const int8_t* weights)
+{
+    const __m128i max = _mm_set1_epi8(NNUE::activation_max);
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+
+    for(int i = 0; i < NNUE::hidden; i += 16)
+    {
+        __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i + 8));
+
+        __m128i act = _mm_min_epu8(_mm_packus_epi16(lo, hi), max);
+
+        __m128i prod = _mm_maddubs_epi16(act, _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i)));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(prod, ones));
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+
+    return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+// kernels in use, picked once by select_kernels
+static void (*apply)(const int16_t*, const int16_t* const*, int, const int16_t* const*, int, int16_t*) = apply_scalar;
+static int32_t (*output_dot)(const int16_t*, const int8_t*) = output_dot_scalar;
+static const char* kernels = "scalar";
+
+static void select_kernels()
+{
+#if defined(NEBULA_NNUE_X86)
+    if(__builtin_cpu_supports("avx2"))
+    {
+        apply = apply_avx2;
+        output_dot = output_dot_avx2;
+        kernels = "avx2";
+    } else if(__builtin_cpu_supports("ssse3"))
+    {
+        apply = apply_ssse3;
+        output_dot = output_dot_ssse3;
+        kernels = "ssse3";
+    }
+#endif
+}
+
+const char* NNUE::simd()
+{
+    return kernels;
+}
+
+bool NNUE::load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if(!in)
+        return false;
+
+    FileHeader header;
+    if(!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+
+    if(std::memcmp(header.magic, "NEBULANN", sizeof(header.magic)) != 0 || header.version != file_version || header.hidden != hidden)
+        return false;
+
+    LargeMemory memory(sizeof(Network));
+    if(!memory.data())
+        return false;
+
+    Network* net = static_cast<Network*>(memory.data());
+
+    // field by field, so the padding in Network never has to match the file
+    in.read(reinterpret_cast<char*>(net->ft_bias), sizeof(net->ft_bias));
+    in.read(reinterpret_cast<char*>(net->ft_weights), sizeof(net->ft_weights));
+    in.read(reinterpret_cast<char*>(net->out_weights), sizeof(net->out_weights));
+    in.read(reinterpret_cast<char*>(&net->out_bias), sizeof(net->out_bias));
+
+    // truncated files and trailing bytes are both wrong networks
+    if(!in || in.peek() != std::ifstream::traits_type::eof())
+        return false;
+
+    network_memory = std::move(memory);
+    network = net;
+    active = true;
+
+    select_kernels();
+
+    return true;
+}
+
+int NNUE::evaluate(const Board& board)
+{
+    const Accumulator& acc = board.accumulator();
+
+    int us = static_cast<int>(board.turn());
+
+    int32_t sum = network->out_bias;
+    sum += output_dot(acc.values[us], network->out_weights);
+    sum += output_dot(acc.values[us ^ 1], network->out_weights + hidden);
+
+    int64_t eval = static_cast<int64_t>(sum) * output_scale / (activation_max * weight_scale);
+
+    // a wild network must not reach mate scores, and the TT and eval cache hold 16 bits
+    return static_cast<int>(eval < -max_eval ? -max_eval : (eval > max_eval ? max_eval : eval));
+}
+
+void NNUE::refresh(const Board& board, int perspective, Accumulator& acc)
+{
+    // a legal position has at most 30 non-king pieces, but a FEN can hold more; rows are
+    // added in batches so none is ever dropped
+    static constexpr int batch = 32;
+
+    const int16_t* rows[batch];
+    int count = 0;
+
+    const int16_t* prev = network->ft_bias;
+    int16_t* out = acc.values[perspective];
+
+    int king_sq = board.king_sq(static_cast<Color>(perspective));
+
+    for(int c = 0; c < 2; ++c)
+    {
+        for(int pt = 0; pt < 5; ++pt)
+        {
+            uint64_t bb = board.pieces(static_cast<Color>(c), static_cast<PieceType>(pt));
+
+            while(bb)
+            {
+                int sq = __builtin_ctzll(bb);
+                rows[count++] = network->ft_weights[feature(perspective, king_sq, sq, c, pt)];
+
+                if(count == batch)
+                {
+                    apply(prev, rows, count, nullptr, 0, out);
+
+                    prev = out;
+                    count = 0;
+                }
+
+                bb &= bb - 1;
+            }
+        }
+    }
+
+    apply(prev, rows, count, nullptr, 0, out);
+}
+
+void NNUE::update(const Accumulator& prev, const Delta& delta, int perspective, int king_sq, Accumulator& acc)
+{
+    const int16_t* add[Delta::capacity];
+    const int16_t* sub[Delta::capacity];
+    int adds = 0, subs = 0;
+
+    for(int i = 0; i < delta.count; ++i)
+    {
+        const Delta::Change& ch = delta.changes[i];
+
+        // kings are not inputs
+        if(ch.piece == static_cast<int>(PieceType::King))
+            continue;
+
+        const int16_t* row = network->ft_weights[feature(perspective, king_sq, ch.sq, ch.color, ch.piece)];
+
+        if(ch.sign > 0)
+            add[adds++] = row;
+        else
+            sub[subs++] = row;
+    }
+
+    apply(prev.values[perspective], add, adds, sub, subs, acc.values[perspective]);
+}
+
+}
@@ -88,7 +88,7 @@ std::string PGNExporter::to_san(const Move& move)
         // disambiguation
         if(pt != static_cast<int>(PieceType::Pawn))
         {
-            std::vector<Move> moves = board->generate_moves();
+            MoveList moves = board->generate_moves();
             bool need_file = false, need_rank = false;
             int count = 0;
             for(const auto& m : moves)
@@ -0,0 +1,25 @@
+#include "nebula/PawnHash.hpp"
+
+#include <cstring>
+
+namespace nebula
+{
+
+PawnHash::PawnHash(size_t entries)
+{
+    size_t size = 1;
+    while(size * 2 <= entries)
+        size *= 2;
+
+    // zero-filled memory is a table of empty entries
+    memory = LargeMemory(size * sizeof(PawnEntry));
+    table = static_cast<PawnEntry*>(memory.data());
+    mask = size - 1;
+}
+
+void PawnHash::clear()
+{
+    std::memset(static_cast<void*>(table), 0, (mask + 1) * sizeof(PawnEntry));
+}
+
+}
@@ -0,0 +1,236 @@
+#include "nebula/Perft.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace nebula
+{
+
+Perft::Perft(int threads, size_t hash_mb):
+    threads(threads < 1 ? 1 : threads), hash(hash_mb * 1024 * 1024 / sizeof(HashEntry)) {}
+
+uint64_t Perft::run(const Board& board, int depth)
+{
+    if(depth <= 0)
+        return 1;
+
+    uint64_t total = 0;
+
+    for(const auto& [move, nodes] : divide(board, depth))
+        total += nodes;
+
+    return total;
+}
+
+std::vector<std::pair<Move, uint64_t>> Perft::divide(const Board& board, int depth)
+{
+    MoveList root = board.generate_moves();
+
+    std::vector<std::pair<Move, uint64_t>> out;
+    for(const Move& move : root)
+        out.emplace_back(move, 1);
+
+    if(depth <= 1)
+        return out;
+
+    // workers claim root moves one at a time
+    std::atomic<int> next{0};
+    auto worker = [&]()
+    {
+        Board b = board;
+
+        for(int i = next++; i < root.size(); i = next++)
+        {
+            b.make_move(root[i]);
+            out[i].second = count(b, depth - 1);
+            b.unmake_move();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for(int t = 1; t < threads; ++t)
+        pool.emplace_back(worker);
+
+    worker();
+
+    for(auto& th : pool)
+        th.join();
+
+    return out;
+}
+
+uint64_t Perft::count(Board& board, int depth)
+{
+    if(depth == 0)
+        return 1;
+
+    uint64_t nodes = 0;
+
+    if(depth >= 2 && probe(board.key(), depth, nodes))
+        return nodes;
+
+    MoveList moves = board.generate_moves();
+
+    // bulk counting: legal moves at the last ply are the leaves
+    if(depth == 1)
+        return moves.size();
+
+    for(const Move& move : moves)
+    {
+        board.make_move(move);
+        nodes += count(board, depth - 1);
+        board.unmake_move();
+    }
+
+    store(board.key(), depth, nodes);
+
+    return nodes;
+}
+
+// the same position at different depths lands in different slots, so they do not evict each other
+static size_t slot(uint64_t key, int depth, size_t size)
+{
+    return (key ^ static_cast<uint64_t>(depth) * 0x9E3779B97F4A7C15ULL) % size;
+}
+
+bool Perft::probe(uint64_t key, int depth, uint64_t& nodes) const
+{
+    if(hash.empty())
+        return false;
+
+    const HashEntry& e = hash[slot(key, depth, hash.size())];
+
+    uint64_t data = e.data.load(std::memory_order_relaxed);
+    uint64_t check = e.key_xor_data.load(std::memory_order_relaxed);
+
+    if((check ^ data) != key || static_cast<int>(data & 0xFF) != depth)
+        return false;
+
+    nodes = data >> 8;
+
+    return true;
+}
+
+void Perft::store(uint64_t key, int depth, uint64_t nodes)
+{
+    if(hash.empty())
+        return;
+
+    HashEntry& e = hash[slot(key, depth, hash.size())];
+
+    uint64_t data = (nodes << 8) | static_cast<uint64_t>(depth & 0xFF);
+
+    e.key_xor_data.store(key ^ data, std::memory_order_relaxed);
+    e.data.store(data, std::memory_order_relaxed);
+}
+
+void perft(const Board& board, int depth, bool divide, int threads, size_t hash_mb)
+{
+    Perft p(threads, hash_mb);
+
+    auto start = std::chrono::steady_clock::now();
+
+    uint64_t total = 0;
+
+    if(divide)
+    {
+        for(const auto& [move, nodes] : p.divide(board, depth))
+        {
+            std::cout << move.uci() << ": " << nodes << '\n';
+            total += nodes;
+        }
+
+        std::cout << '\n';
+    } else
+    {
+        total = p.run(board, depth);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Depth: " << depth << '\n';
+    std::cout << "Nodes: " << total << '\n';
+    std::cout << "Time: " << seconds * 1000.0 << " ms\n";
+    std::cout << "NPS: " << static_cast<uint64_t>(seconds > 0 ? total / seconds : 0) << "\n\n";
+}
+
+int perft_suite(const std::string& path, int max_depth, int threads, size_t hash_mb)
+{
+    std::ifstream in(path);
+    if(!in)
+    {
+        std::cerr << "Could not open EPD file: " << path << '\n';
+        return 1;
+    }
+
+    int failures = 0;
+    int positions = 0;
+    uint64_t total = 0;
+    double seconds = 0.0;
+
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(line.empty() || line[0] == '#')
+            continue;
+
+        // FEN first, then ";Dn count" fields
+        std::istringstream fields(line);
+        std::string fen;
+        std::getline(fields, fen, ';');
+
+        // EPD positions may leave out the move counters
+        std::istringstream fen_words(fen);
+        std::string word;
+        int n = 0;
+        while(fen_words >> word)
+            ++n;
+        if(n == 4)
+            fen += " 0 1";
+
+        Board board(fen);
+        ++positions;
+
+        // hash entries are keyed by position, so each position gets a fresh table
+        Perft p(threads, hash_mb);
+
+        std::string check;
+        while(std::getline(fields, check, ';'))
+        {
+            std::istringstream ciss(check);
+            std::string d;
+            uint64_t expected;
+
+            if(!(ciss >> d >> expected) || d.size() < 2 || d[0] != 'D')
+                continue;
+
+            int depth = std::stoi(d.substr(1));
+            if(max_depth > 0 && depth > max_depth)
+                continue;
+
+            auto start = std::chrono::steady_clock::now();
+            uint64_t nodes = p.run(board, depth);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            total += nodes;
+
+            if(nodes != expected)
+            {
+                ++failures;
+                std::cout << "FAIL " << fen << " depth " << depth << ": expected " << expected << ", got " << nodes << '\n';
+            }
+        }
+    }
+
+    std::cout << "Positions: " << positions << '\n';
+    std::cout << "Failures: " << failures << '\n';
+    std::cout << "Nodes: " << total << '\n';
+    std::cout << "Time: " << seconds * 1000.0 << " ms\n";
+    std::cout << "NPS: " << static_cast<uint64_t>(seconds > 0 ? total / seconds : 0) << "\n\n";
+
+    return failures;
+}
+
+}
@@ -1,27 +1,239 @@
 #include "nebula/Search.hpp"
 #include "nebula/Evaluate.hpp"
+#include "nebula/MovePicker.hpp"
+
+#include <iomanip>
+#include <iostream>
 
 namespace nebula
 {
 
-Search::Search(int max):
-    max_depth(max), killers(max_depth + 1, { Move{}, Move{} })
+Search::Search(int max, int threads, size_t hash_mb):
+    tt(hash_mb), stop(false), soft_time(0), hard_time(0), pool(threads > 1 ? threads - 1 : 0)
+{
+    for(int i = 0; i < std::max(1, threads); ++i)
+        workers.push_back(std::make_unique<SearchWorker>(max, *this, i == 0));
+}
+
+bool Search::best_move(const Board& b, Move& out_best, double& eval, const SearchLimits& l)
+{
+    limits = l;
+    start_time = std::chrono::steady_clock::now();
+    init_time(b.turn());
+
+    stop = false;
+    tt.new_search();
+
+    // helpers alternate between the nominal depth and one ply deeper so their TT entries lead the main thread
+    pool.start([&](int i)
+    {
+        Move m;
+        int e;
+
+        workers[i + 1]->search(b, (i + 1) % 2, m, e);
+    });
+
+    int best_eval;
+    bool found = workers[0]->search(b, 0, out_best, best_eval);
+
+    // main thread is done; helpers abandon their iteration
+    stop = true;
+    pool.wait();
+
+    last_stats = workers[0]->stats;
+    for(size_t i = 1; i < workers.size(); ++i)
+        last_stats.merge(workers[i]->stats);
+    last_stats.nodes = total_nodes();
+
+    if(!found)
+        return false;
+
+    eval = static_cast<double>(b.turn() == Color::White ? best_eval : -best_eval) / 100.0;
+
+    return true;
+}
+
+void Search::clear()
+{
+    tt.clear(pool);
+    eval_cache.clear();
+
+    // pawn hashes belong to the threads that search, so each one empties its own
+    pool.start([](int) { Evaluate::clear_pawn_hash(); });
+    Evaluate::clear_pawn_hash();
+    pool.wait();
+
+    for(auto& w : workers)
+    {
+        w->clear_history();
+        std::fill(w->killers.begin(), w->killers.end(), std::array<Move, 2>{ Move{}, Move{} });
+    }
+}
+
+void Search::init_time(Color us)
+{
+    soft_time = 0;
+    hard_time = 0;
+
+    if(limits.movetime > 0)
+    {
+        soft_time = hard_time = limits.movetime;
+    } else if(limits.time[static_cast<int>(us)] > 0)
+    {
+        int64_t left = limits.time[static_cast<int>(us)];
+        int64_t inc = limits.inc[static_cast<int>(us)];
+
+        // aim for an even share of the clock, allow overrunning it in hard positions
+        soft_time = left / moves_to_go + inc * 3 / 4;
+        hard_time = std::min(left / 4 + inc, soft_time * 5);
+
+        int64_t usable = std::max<int64_t>(1, left - move_overhead);
+        soft_time = std::clamp<int64_t>(soft_time, 1, usable);
+        hard_time = std::clamp<int64_t>(hard_time, soft_time, usable);
+    }
+}
+
+uint64_t Search::total_nodes() const
+{
+    uint64_t total = 0;
+
+    for(const auto& w : workers)
+        total += w->nodes.load(std::memory_order_relaxed);
+
+    return total;
+}
+
+void Search::check_limits()
+{
+    if((hard_time > 0 && elapsed() >= hard_time) || (limits.nodes > 0 && total_nodes() >= limits.nodes))
+        stop = true;
+}
+
+bool Search::soft_limit_reached(int stable_iterations) const
+{
+    if(limits.nodes > 0 && total_nodes() >= limits.nodes)
+        return true;
+
+    if(soft_time == 0)
+        return false;
+
+    // the longer the best move holds, the less time it deserves
+    int64_t budget = soft_time;
+    if(stable_iterations >= 4)
+        budget = soft_time * 2 / 5;
+    else if(stable_iterations >= 2)
+        budget = soft_time * 7 / 10;
+
+    return elapsed() >= budget;
+}
+
+void SearchStats::merge(const SearchStats& other)
+{
+    qnodes += other.qnodes;
+
+    tt_probes += other.tt_probes;
+    tt_hits += other.tt_hits;
+    tt_cutoffs += other.tt_cutoffs;
+
+    null_prunes += other.null_prunes;
+    razor_prunes += other.razor_prunes;
+    rfp_prunes += other.rfp_prunes;
+    futility_prunes += other.futility_prunes;
+    lmp_prunes += other.lmp_prunes;
+
+    lmr_researches += other.lmr_researches;
+
+    evals += other.evals;
+    eval_cache_hits += other.eval_cache_hits;
+    lazy_evals += other.lazy_evals;
+
+    for(int i = 0; i < cutoff_buckets; ++i)
+        cutoffs[i] += other.cutoffs[i];
+}
+
+void SearchStats::print() const
+{
+    auto percent = [](uint64_t part, uint64_t whole) { return whole ? 100.0 * part / whole : 0.0; };
+
+    // keep the caller's number format
+    std::ios_base::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+
+    std::cout << std::fixed << std::setprecision(1);
+
+    std::cout << "Nodes: " << nodes << " (qnodes " << qnodes << ", " << percent(qnodes, nodes) << "%)\n";
+    std::cout << "TT: " << tt_probes << " probes, " << tt_hits << " hits (" << percent(tt_hits, tt_probes) << "%), " << tt_cutoffs << " cutoffs\n";
+    std::cout << "Pruned: null " << null_prunes << ", razor " << razor_prunes << ", rfp " << rfp_prunes
+              << ", futility " << futility_prunes << ", lmp " << lmp_prunes << '\n';
+    std::cout << "LMR re-searches: " << lmr_researches << '\n';
+    std::cout << "Evals: " << evals << " (" << percent(eval_cache_hits, evals) << "% from the eval cache, " << percent(lazy_evals, evals) << "% lazy)\n";
+
+    uint64_t total_cutoffs = 0;
+    for(uint64_t c : cutoffs)
+        total_cutoffs += c;
+
+    std::cout << "Cutoff move index:";
+    for(int i = 0; i < cutoff_buckets; ++i)
+        std::cout << ' ' << (i + 1) << (i == cutoff_buckets - 1 ? "+" : "") << ": " << percent(cutoffs[i], total_cutoffs) << '%';
+    std::cout << '\n';
+
+    uint64_t prev_nodes = 0;
+    uint64_t prev_iteration = 0;
+
+    for(const Iteration& it : iterations)
+    {
+        uint64_t iteration_nodes = it.nodes - prev_nodes;
+
+        std::cout << "  depth " << it.depth << ": " << iteration_nodes << " nodes, "
+                  << static_cast<uint64_t>(it.ms > 0 ? it.nodes * 1000 / it.ms : 0) << " nps";
+
+        // effective branching factor: growth of the tree from the previous iteration
+        if(prev_iteration > 0)
+            std::cout << ", ebf " << static_cast<double>(iteration_nodes) / prev_iteration;
+
+        std::cout << '\n';
+
+        prev_nodes = it.nodes;
+        prev_iteration = iteration_nodes;
+    }
+
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
+
+SearchWorker::SearchWorker(int max, Search& owner, bool main):
+    max_depth(max), killers(max_depth + 2, { Move{}, Move{} }), tt(owner.tt), eval_cache(owner.eval_cache), stop(owner.stop), owner(owner), main(main), nodes(0)
 {
     clear_history();
 }
 
-bool Search::best_move(const Board& b, Move& out_best, double& eval)
+void SearchWorker::count_node()
+{
+    uint64_t n = nodes.load(std::memory_order_relaxed) + 1;
+    nodes.store(n, std::memory_order_relaxed);
+
+    if(main && n % poll_interval == 0)
+        owner.check_limits();
+}
+
+bool SearchWorker::search(const Board& b, int depth_offset, Move& out_best, int& out_eval)
 {
     // lots of operations need a mutable board
     Board board = b;
 
-    std::vector<Move> legal_moves = board.generate_moves();
+    nodes = 0;
+    stats = SearchStats{};
+
+    MoveList legal_moves = board.generate_moves();
 
     if(legal_moves.empty())
         return false;
     
     Move best_move = legal_moves[0];
     int best_eval = -infinity;
+
+    // consecutive iterations that kept the same best move
+    int stable_iterations = 0;
     
     // aspiration window parameters
     int initial_window = 50;
@@ -29,7 +241,7 @@ bool Search::best_move(const Board& b, Move& out_best, double& eval)
     int window_multiplier = 2;
     
     // iterative deepening with aspiration windows
-    for(int depth = 1; depth <= max_depth; ++depth)
+    for(int depth = 1; depth <= max_depth + depth_offset; ++depth)
     {
         int current_best = -infinity;
         Move current_move = legal_moves[0];
@@ -157,7 +369,18 @@ bool Search::best_move(const Board& b, Move& out_best, double& eval)
             }
         }
         
+        // an interrupted iteration is incomplete; keep the last finished one
+        if(stopped())
+        {
+            // nothing finished yet: the first move in order and the static eval beat -infinity
+            if(depth == 1)
+                best_eval = evaluate(board);
+
+            break;
+        }
+
         // update best move and evaluation
+        stable_iterations = (depth > 1 && current_move == best_move) ? stable_iterations + 1 : 0;
         best_eval = current_best;
         best_move = current_move;
         
@@ -165,16 +388,28 @@ bool Search::best_move(const Board& b, Move& out_best, double& eval)
         auto it = std::find(legal_moves.begin(), legal_moves.end(), best_move);
         if(it != legal_moves.end())
             std::swap(*it, legal_moves[0]);
+
+        if(main)
+            NEBULA_STAT(stats.iterations.push_back({ depth, owner.total_nodes(), owner.elapsed() }));
+
+        // out of time for another iteration
+        if(main && owner.soft_limit_reached(stable_iterations))
+            break;
     }
     
     out_best = best_move;
-    eval = static_cast<double>(board.turn() == Color::White ? best_eval : -best_eval) / 100.0;
+    out_eval = best_eval;
 
     return true;
 }
 
-int Search::pvs(Board& board, int depth, int alpha, int beta, bool null_move_allowed)
+int SearchWorker::pvs(Board& board, int depth, int alpha, int beta, bool null_move_allowed)
 {
+    if(stopped())
+        return 0;
+
+    count_node();
+
     uint64_t key = board.key();
 
     // draw options
@@ -182,36 +417,59 @@ int Search::pvs(Board& board, int depth, int alpha, int beta, bool null_move_all
         return 0;
 
     // check transposition table
-    const TTEntry* tt_entry = tt.probe(key);
+    TTData tt_data;
     Move tt_move;
     bool has_tt_move = false;
 
-    if(tt_entry)
+    NEBULA_STAT(++stats.tt_probes);
+
+    bool tt_hit = tt.probe(key, tt_data);
+
+    if(tt_hit)
     {
-        tt_move = tt_entry->move;
+        tt_move = board.decode_move(tt_data.move);
         has_tt_move = true;
 
-        if(tt_entry->depth >= depth)
+        NEBULA_STAT(++stats.tt_hits);
+
+        if(tt_data.depth >= depth)
         {
-            int tt_score = tt_entry->eval;
+            int tt_score = score_from_tt(tt_data.eval);
+
+            if(tt_data.flag == TTFlag::Exact
+                || (tt_data.flag == TTFlag::LowerBound && tt_score >= beta)
+                || (tt_data.flag == TTFlag::UpperBound && tt_score <= alpha))
+            {
+                NEBULA_STAT(++stats.tt_cutoffs);
 
-            if(tt_entry->flag == TTFlag::Exact)
-                return tt_score;
-            else if(tt_entry->flag == TTFlag::LowerBound && tt_score >= beta)
-                return tt_score;
-            else if(tt_entry->flag == TTFlag::UpperBound && tt_score <= alpha)
                 return tt_score;
+            }
         }
     }
 
     // cache in check
     bool board_in_check = board.in_check();
 
+    // static eval, computed at most once per node; the TT entry may already carry it
+    int static_eval = -infinity;
+    bool static_eval_computed = false;
+
+    if(tt_hit && tt_data.static_eval != TranspositionTable::no_eval)
+    {
+        static_eval = tt_data.static_eval;
+        static_eval_computed = true;
+    }
+
     // razoring
     if(depth <= 3 && !board_in_check && std::abs(beta) < mate_score - 100)
     {
         int razor_margin = 300 + 50 * depth;
-        int static_eval = Evaluate::evaluate(board);
+
+        if(!static_eval_computed)
+        {
+            static_eval = evaluate(board);
+            static_eval_computed = true;
+        }
 
         if(static_eval + razor_margin < beta)
         {
@@ -219,7 +477,11 @@ int Search::pvs(Board& board, int depth, int alpha, int beta, bool null_move_all
             int razor_score = quiesce(board, 0, alpha, beta);
 
             if(razor_score < beta)
+            {
+                NEBULA_STAT(++stats.razor_prunes);
+
                 return razor_score;
+            }
         }
     }
 
@@ -229,18 +491,28 @@ int Search::pvs(Board& board, int depth, int alpha, int beta, bool null_move_all
     // reverse futility pruning
     if(depth <= 7 && !board_in_check && std::abs(beta) < mate_score - 100 && beta - alpha > 1)
     {
-        int static_eval = Evaluate::evaluate(board);
+        if(!static_eval_computed)
+        {
+            static_eval = evaluate(board);
+            static_eval_computed = true;
+        }
+
         int rfp_margin = 120 * depth;
 
         // conservative scoring
         if(static_eval - rfp_margin >= beta)
+        {
+            NEBULA_STAT(++stats.rfp_prunes);
+
             return static_eval - rfp_margin;
+        }
     }
 
     // null move pruning
     if(null_move_allowed && board.should_try_null_move(depth) && beta < mate_score - 100 && alpha > -mate_score + 100)
     {
         board.make_null_move();
+        tt.prefetch(board.key());
 
         int score = -pvs(board, depth - 3, -beta, -beta + 1, false);
 
@@ -248,36 +520,42 @@ int Search::pvs(Board& board, int depth, int alpha, int beta, bool null_move_all
 
         // if null move causes beta cutoff, we can prune
         if(score >= beta) // don't return mate scores from null move
+        {
+            NEBULA_STAT(++stats.null_prunes);
+
             return score >= mate_score - 100 ? beta : score;
+        }
     }
     
-    std::vector<Move> moves = board.generate_moves();
-
-    // checkmate or stalemate
-    if(moves.empty())
-        return board_in_check ? -mate_score + (max_depth - depth) : 0;
-    
-    order_moves(moves, board, depth, has_tt_move ? &tt_move : nullptr);
+    // moves are generated and ordered lazily, stage by stage
+    const std::array<Move, 2>* killer = (depth >= 0 && depth < static_cast<int>(killers.size())) ? &killers[depth] : nullptr;
+    MovePicker picker(board, *this, has_tt_move ? &tt_move : nullptr, killer);
 
     int best_score = -infinity;
-    Move best_move = moves[0];
+    Move best_move{};
     bool pv_node = (beta - alpha > 1);
 
     int move_count = 0;
     int quiet_moves_searched = 0;
 
-    // cache static eval
-    int static_eval = -infinity;
-    bool static_eval_computed = false;
-    
+    // moves that got past the pruning below, for the cutoff statistics
+    int moves_searched = 0;
+
+    // quiet moves tried so far, for history updates
+    MoveList quiets_tried;
+
     // prep for futility pruning
     bool futility_pruning = false;
     int futility_margin = 0;
 
     if(depth <= 8 && !board_in_check && !pv_node && std::abs(alpha) < mate_score - 100)
     {
-        static_eval = Evaluate::evaluate(board);
-        static_eval_computed = true;
+        if(!static_eval_computed)
+        {
+            static_eval = evaluate(board);
+            static_eval_computed = true;
+        }
+
         futility_margin = 100 + 50 * depth;
 
         if(static_eval + futility_margin < alpha)
@@ -287,32 +565,48 @@ int Search::pvs(Board& board, int depth, int alpha, int beta, bool null_move_all
     Color c = board.turn();
 
     // recursive call for each move
-    for(const Move& move : moves)
+    Move move;
+    while(picker.next(move))
     {
         ++move_count;
 
+        // fallback best move if everything fails low
+        if(move_count == 1)
+            best_move = move;
+
         bool is_quiet = !is_capture(move) && !is_promotion(move);
 
         if(is_quiet)
+        {
             ++quiet_moves_searched;
+            quiets_tried.push_back(move);
+        }
         
         // futility pruning
-        if(futility_pruning && is_quiet && !gives_check(board, move))
+        if(futility_pruning && is_quiet && !board.gives_check(move))
+        {
+            NEBULA_STAT(++stats.futility_prunes);
+
             continue;
+        }
         
         // aggressive futility pruning at depth 1
-        if(depth == 1 && !board_in_check && !pv_node && is_quiet && !gives_check(board, move) && std::abs(alpha) < mate_score - 100)
+        if(depth == 1 && !board_in_check && !pv_node && is_quiet && !board.gives_check(move) && std::abs(alpha) < mate_score - 100)
         {
             if(!static_eval_computed)
             {
-                static_eval = Evaluate::evaluate(board);
+                static_eval = evaluate(board);
                 static_eval_computed = true;
             }
 
             int extended_margin = 200;
 
             if(static_eval + extended_margin < alpha)
+            {
+                NEBULA_STAT(++stats.futility_prunes);
+
                 continue;
+            }
         }
 
         // late move pruning
@@ -321,11 +615,20 @@ int Search::pvs(Board& board, int depth, int alpha, int beta, bool null_move_all
             int lmp_threshold = 3 + depth * depth;
 
             if(quiet_moves_searched >= lmp_threshold)
+            {
+                NEBULA_STAT(++stats.lmp_prunes);
+
                 continue;
+            }
         }
 
+        ++moves_searched;
+
         board.make_move(move);
 
+        // the child probes the TT first; overlap that miss with the work below
+        tt.prefetch(board.key());
+
         // check extension
         int extension = 0;
         bool gives_check_flag = board.in_check();
@@ -355,7 +658,11 @@ int Search::pvs(Board& board, int depth, int alpha, int beta, bool null_move_all
                 score = -pvs(board, new_depth - reduction, -alpha - 1, -alpha);
 
                 if(score > alpha)
+                {
+                    NEBULA_STAT(++stats.lmr_researches);
+
                     score = -pvs(board, new_depth, -alpha - 1, -alpha);
+                }
             } else
             {
                 // null window search first
@@ -368,6 +675,10 @@ int Search::pvs(Board& board, int depth, int alpha, int beta, bool null_move_all
         }
 
         board.unmake_move();
+
+        // result is meaningless once stopped; don't let it reach the TT
+        if(stopped())
+            return 0;
         
         // update score
         if(score > best_score)
@@ -379,13 +690,15 @@ int Search::pvs(Board& board, int depth, int alpha, int beta, bool null_move_all
         // beta cutoff (opponent won't allow this)
         if(score >= beta)
         {
+            NEBULA_STAT(++stats.cutoffs[std::min(moves_searched, SearchStats::cutoff_buckets) - 1]);
+
             // update history for move that caused the cutoff
             update_history(move, c, depth, true);
 
             // update history for all moves that didn't cause a cutoff
-            for(int i = 0; i < move_count - 1; i++)
-                if(!is_capture(moves[i]) && !is_promotion(moves[i]))
-                    update_history(moves[i], c, depth, false);
+            for(int i = 0; i < quiets_tried.size(); ++i)
+                if(!(quiets_tried[i] == move))
+                    update_history(quiets_tried[i], c, depth, false);
 
             if(!is_capture(move))
             {
@@ -396,7 +709,7 @@ int Search::pvs(Board& board, int depth, int alpha, int beta, bool null_move_all
                 killer[0] = move;
             }
             
-            tt.store(key, score, depth, TTFlag::LowerBound, move);
+            tt.store(key, score_to_tt(score), depth, TTFlag::LowerBound, move.encode(), static_eval_computed ? static_eval : TranspositionTable::no_eval);
 
             return score;
         }
@@ -406,59 +719,70 @@ int Search::pvs(Board& board, int depth, int alpha, int beta, bool null_move_all
             alpha = score;
     }
 
+    // checkmate or stalemate
+    if(move_count == 0)
+        return board_in_check ? -mate_score + (max_depth - depth) : 0;
+
     // futility pruning
     if(futility_pruning && best_score == -infinity)
     {
         if(!static_eval_computed)
-            static_eval = Evaluate::evaluate(board);
+            static_eval = evaluate(board);
         
         return static_eval;
     }
 
-    tt.store(key, best_score, depth, (best_score <= alpha) ? TTFlag::UpperBound : TTFlag::Exact, best_move);
+    tt.store(key, score_to_tt(best_score), depth, (best_score <= alpha) ? TTFlag::UpperBound : TTFlag::Exact, best_move.encode(), static_eval_computed ? static_eval : TranspositionTable::no_eval);
 
     return best_score;
 }
 
-int Search::quiesce(Board& board, int depth, int alpha, int beta)
+int SearchWorker::quiesce(Board& board, int depth, int alpha, int beta)
 {
-    int stand_pat = Evaluate::evaluate(board);
+    if(stopped())
+        return 0;
+
+    count_node();
+
+    NEBULA_STAT(++stats.qnodes);
+
+    // exact only where it matters: below alpha - delta_margin() or at beta and above, a bound will do
+    int stand_pat = evaluate(board, alpha - delta_margin() - 1, beta);
 
     // beta cutoff
     if(stand_pat >= beta)
         return stand_pat;
     
     // delta pruning
-    if(stand_pat + delta_margin < alpha)
+    if(stand_pat + delta_margin() < alpha)
         return stand_pat; 
     
     // update alpha
     if(stand_pat > alpha)
         alpha = stand_pat;
     
-    // only keep important moves
-    std::vector<Move> important = board.generate_moves();
-    important.erase(std::remove_if(important.begin(), important.end(), [&](const Move& m)
-    {
-        return !is_capture(m) && !is_promotion(m) && !gives_check(board, m);
-    }), important.end());
-
-    // no important moves
-    if(important.empty())
-        return stand_pat;
-
-    order_moves(important, board, depth);
+    // captures and promotions, then quiet checks
+    MovePicker picker(board, *this);
+    bool in_check = board.in_check();
+    int important = 0;
 
     // recursive call for each imporant move
-    for(const Move& move : important)
+    Move move;
+    while(picker.next(move))
     {
+        // in check only tactical evasions count as important
+        if(in_check && !is_capture(move) && !is_promotion(move) && !board.gives_check(move))
+            continue;
+
+        ++important;
+
         // gain approximation
         int gain = 0;
         if(is_capture(move) && move.capture != 0xFF)
-            gain = Values::material_value[move.capture & 0b111] - Values::material_value[move.piece & 0b111];
+            gain = Values::params.material_value[move.capture & 0b111] - Values::params.material_value[move.piece & 0b111];
 
         // delta cutoff
-        if(stand_pat + gain + Values::material_value[static_cast<int>(PieceType::Queen)] < alpha)
+        if(stand_pat + gain + delta_margin() < alpha)
             continue;
         
         board.make_move(move);
@@ -476,22 +800,22 @@ int Search::quiesce(Board& board, int depth, int alpha, int beta)
             alpha = score;
     }
 
+    // no important moves
+    if(important == 0)
+        return stand_pat;
+
     return alpha;
 }
 
-void Search::order_moves(std::vector<Move>& moves, Board& board, int depth, const Move* pv_move)
+void SearchWorker::order_moves(MoveList& moves, Board& board, int depth, const Move* pv_move)
 {
-    // assign scores to moves for sorting
-    std::vector<std::pair<int, size_t>> move_scores;
-    move_scores.reserve(moves.size());
-
     const std::array<Move, 2>* killer = nullptr;
     if(depth >= 0 && depth < static_cast<int>(killers.size()))
         killer = &killers[depth];
 
     Color c = board.turn();
 
-    for(size_t i = 0; i < moves.size(); ++i)
+    for(int i = 0; i < moves.size(); ++i)
     {
         const Move& move = moves[i];
         int score = 0;
@@ -517,8 +841,8 @@ void Search::order_moves(std::vector<Move>& moves, Board& board, int depth, cons
             // most valuable victim - least valuable attacker
             if(move.capture != 0xFF)
             {
-                int victim_value = Values::material_value[move.capture & 0b111];
-                int attacker_value = Values::material_value[move.piece & 0b111];
+                int victim_value = Values::params.material_value[move.capture & 0b111];
+                int attacker_value = Values::params.material_value[move.piece & 0b111];
                 score += victim_value - attacker_value / 10;
             }
         }
@@ -528,7 +852,7 @@ void Search::order_moves(std::vector<Move>& moves, Board& board, int depth, cons
         {
             score += 900;
             if(move.promo != 0xFF)
-                score += Values::material_value[move.promo] / 10;
+                score += Values::params.material_value[move.promo] / 10;
         }
 
         // history heuristic for quiet moves
@@ -536,36 +860,92 @@ void Search::order_moves(std::vector<Move>& moves, Board& board, int depth, cons
             score += get_history_score(move, c);
         
         // checks
-        if(gives_check(board, move))
+        if(board.gives_check(move))
             score += 50;
         
         // castling moves
         if(move.flags & (static_cast<uint8_t>(MoveFlag::KingCastle) | static_cast<uint8_t>(MoveFlag::QueenCastle)))
             score += 25;
         
-        move_scores.emplace_back(score, i);
+        // store score alongside the move for sorting
+        moves.score(i) = score;
     }
     
     // sort by score
-    std::sort(move_scores.begin(), move_scores.end(), [](const auto& a, const auto& b){ return a.first > b.first; });
-    
-    // reorder moves based on scores
-    std::vector<Move> ordered_moves;
-    ordered_moves.reserve(moves.size());
-    
-    for(const auto& pair : move_scores)
-        ordered_moves.push_back(moves[pair.second]);
-    
-    moves = std::move(ordered_moves);
+    moves.sort();
+}
+
+int SearchWorker::evaluate(const Board& board)
+{
+    NEBULA_STAT(++stats.evals);
+
+    int eval;
+    if(eval_cache.probe(board.key(), eval))
+    {
+        NEBULA_STAT(++stats.eval_cache_hits);
+
+        return eval;
+    }
+
+    eval = Evaluate::evaluate(board);
+    eval_cache.store(board.key(), eval);
+
+    return eval;
+}
+
+int SearchWorker::evaluate(const Board& board, int alpha, int beta)
+{
+    NEBULA_STAT(++stats.evals);
+
+    int eval;
+    if(eval_cache.probe(board.key(), eval))
+    {
+        NEBULA_STAT(++stats.eval_cache_hits);
+
+        return eval;
+    }
+
+    bool exact;
+    eval = Evaluate::evaluate(board, alpha, beta, &exact);
+
+    // bounds must not be mistaken for the real eval later
+    if(exact)
+        eval_cache.store(board.key(), eval);
+    else
+        NEBULA_STAT(++stats.lazy_evals);
+
+    return eval;
+}
+
+int SearchWorker::score_to_tt(int score)
+{
+    if(score >= mate_score - mate_window)
+        return std::min(tt_mate, tt_mate - (mate_score - score));
+
+    if(score <= -mate_score + mate_window)
+        return std::max(-tt_mate, -tt_mate + (score + mate_score));
+
+    return std::clamp(score, -tt_mate + mate_window + 1, tt_mate - mate_window - 1);
+}
+
+int SearchWorker::score_from_tt(int score)
+{
+    if(score >= tt_mate - mate_window)
+        return mate_score - (tt_mate - score);
+
+    if(score <= -tt_mate + mate_window)
+        return -mate_score + (tt_mate + score);
+
+    return score;
 }
 
-void Search::clear_history()
+void SearchWorker::clear_history()
 {
     std::memset(history, 0, sizeof(history));
     std::memset(butterfly, 0, sizeof(butterfly));
 }
 
-void Search::scale_history()
+void SearchWorker::scale_history()
 {
     for(int c = 0; c < 2; ++c)
         for(int from = 0; from < 64; ++from)
@@ -573,7 +953,7 @@ void Search::scale_history()
                 history[c][from][to] /= 2;
 }
 
-void Search::update_history(const Move& move, Color color, int depth, bool cutoff)
+void SearchWorker::update_history(const Move& move, Color color, int depth, bool cutoff)
 {
     // don't update history for tactical moves
     if(is_capture(move) || is_promotion(move))
@@ -598,7 +978,7 @@ void Search::update_history(const Move& move, Color color, int depth, bool cutof
     ++butterfly[c][move.from][move.to];
 }
 
-int Search::get_history_score(const Move& move, Color color) const
+int SearchWorker::get_history_score(const Move& move, Color color) const
 {
     // no history for tactical moves
     if(is_capture(move) || is_promotion(move))
@@ -0,0 +1,80 @@
+#include "nebula/ThreadPool.hpp"
+
+namespace nebula
+{
+
+ThreadPool::ThreadPool(int n):
+    generation(0), running(0), quit(false)
+{
+    for(int i = 0; i < n; ++i)
+        threads.emplace_back(&ThreadPool::loop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+
+    wake.notify_all();
+
+    for(auto& t : threads)
+        t.join();
+}
+
+void ThreadPool::start(const std::function<void(int)>& job)
+{
+    if(threads.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        current_job = job;
+        running = size();
+        ++generation;
+    }
+
+    wake.notify_all();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    done.wait(lock, [&]{ return running == 0; });
+}
+
+void ThreadPool::loop(int index)
+{
+    unsigned long seen = 0;
+
+    while(true)
+    {
+        std::function<void(int)> job;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            wake.wait(lock, [&]{ return quit || generation != seen; });
+
+            if(quit)
+                return;
+
+            seen = generation;
+            job = current_job;
+        }
+
+        job(index);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if(--running == 0)
+                done.notify_all();
+        }
+    }
+}
+
+}
@@ -1,43 +1,258 @@
 #include "nebula/TranspositionTable.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
 namespace nebula
 {
 
-TranspositionTable::TranspositionTable():
-    table(kNumEntries) {}
+TranspositionTable::TranspositionTable(size_t mb):
+    table(nullptr), clusters(0), generation(0), header(nullptr)
+{
+    resize(mb * 1024 * 1024);
+}
+
+void TranspositionTable::resize(size_t bytes)
+{
+    // drop the old table first so both never exist at once
+    memory = LargeMemory();
+    header = nullptr;
+    attached_path.clear();
+
+    clusters = std::max<size_t>(1, bytes / sizeof(TTCluster));
+    memory = LargeMemory(clusters * sizeof(TTCluster));
+
+    // fresh memory is all zero bits, which is exactly an empty entry; constructing the
+    // clusters would fault in every page up front, so they are left for the search to touch
+    table = static_cast<TTCluster*>(memory.data());
+}
+
+bool TranspositionTable::attach(const std::string& path, size_t bytes, std::string& error)
+{
+    // only a missing or empty file may become a new table; anything else could be someone's data
+    if(LargeMemory::file_size(path) != 0)
+    {
+        if(!map_table(path, true))
+        {
+            error = path + " is not a table this build can use (wrong signature, version or size)";
+
+            return false;
+        }
+
+        attached_path = path;
+
+        return true;
+    }
+
+    size_t count = std::max<size_t>(1, bytes / sizeof(TTCluster));
+
+    // the grown file is sparse zeros, i.e. empty entries
+    LargeMemory file = LargeMemory::map_file(path, sizeof(FileHeader) + count * sizeof(TTCluster), true);
+    if(!file.data())
+    {
+        error = "could not create " + path;
+
+        return false;
+    }
+
+    adopt(std::move(file), count);
+    generation = 0;
+    fill_header(*header);
+
+    attached_path = path;
+
+    return true;
+}
+
+bool TranspositionTable::load(const std::string& path)
+{
+    if(!map_table(path, false))
+        return false;
+
+    attached_path.clear();
+
+    return true;
+}
+
+bool TranspositionTable::save(const std::string& path)
+{
+    if(header && path == attached_path)
+    {
+        fill_header(*header);
+
+        return memory.sync();
+    }
+
+    FileHeader h{};
+    fill_header(h);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(table), static_cast<std::streamsize>(clusters * sizeof(TTCluster)));
+
+    return static_cast<bool>(out);
+}
+
+bool TranspositionTable::map_table(const std::string& path, bool shared)
+{
+    size_t size = LargeMemory::file_size(path);
+    if(size <= sizeof(FileHeader) || (size - sizeof(FileHeader)) % sizeof(TTCluster) != 0)
+        return false;
+
+    LargeMemory file = LargeMemory::map_file(path, size, shared);
+    if(!file.data())
+        return false;
+
+    // a table written by a different layout would be garbage
+    const FileHeader& h = *static_cast<const FileHeader*>(file.data());
+    size_t count = (size - sizeof(FileHeader)) / sizeof(TTCluster);
+
+    if(std::memcmp(h.magic, FileHeader::signature, sizeof(h.magic)) != 0 || h.version != FileHeader::current_version
+        || h.cluster_bytes != sizeof(TTCluster) || h.clusters != count)
+        return false;
+
+    generation = h.generation & generation_mask;
+    adopt(std::move(file), count);
+
+    return true;
+}
+
+void TranspositionTable::adopt(LargeMemory&& file, size_t count)
+{
+    memory = std::move(file);
+
+    header = static_cast<FileHeader*>(memory.data());
+    table = reinterpret_cast<TTCluster*>(static_cast<char*>(memory.data()) + sizeof(FileHeader));
+    clusters = count;
+}
+
+void TranspositionTable::fill_header(FileHeader& h) const
+{
+    std::memcpy(h.magic, FileHeader::signature, sizeof(h.magic));
+    h.version = FileHeader::current_version;
+    h.cluster_bytes = sizeof(TTCluster);
+    h.clusters = clusters;
+    h.generation = generation;
+}
 
 void TranspositionTable::clear()
 {
-    for(auto& entry : table)
-        entry = TTEntry{};
+    std::memset(static_cast<void*>(table), 0, clusters * sizeof(TTCluster));
+
+    generation = 0;
 }
 
-const TTEntry* TranspositionTable::probe(uint64_t key) const
+void TranspositionTable::clear(ThreadPool& pool)
 {
-    const TTEntry& entry = table[key & kIndexMask];
+    size_t parts = static_cast<size_t>(pool.size()) + 1;
+
+    auto clear_part = [&](size_t part)
+    {
+        size_t begin = clusters * part / parts;
+        size_t end = clusters * (part + 1) / parts;
 
-    return entry.is_valid(key) ? &entry : nullptr;
+        std::memset(static_cast<void*>(table + begin), 0, (end - begin) * sizeof(TTCluster));
+    };
+
+    pool.start([&](int i) { clear_part(static_cast<size_t>(i) + 1); });
+    clear_part(0);
+    pool.wait();
+
+    generation = 0;
 }
 
-TTEntry* TranspositionTable::probe(uint64_t key)
+bool TranspositionTable::probe(uint64_t key, TTData& out)
 {
-    TTEntry& entry = table[key & kIndexMask];
+    TTCluster& cluster = table[index(key)];
+
+    for(int i = 0; i < TTCluster::size; ++i)
+    {
+        uint64_t data = cluster.data[i].load(std::memory_order_relaxed);
+
+        if(cluster.check[i].load(std::memory_order_relaxed) != check_of(key, data) || gen_bound_of(data) == 0)
+            continue;
 
-    return entry.is_valid(key) ? &entry : nullptr;
+        // still useful, so don't let it age out
+        if(age(data) != 0)
+        {
+            uint64_t refreshed = pack(move_of(data), eval_of(data), depth_of(data), static_cast<uint8_t>((generation << 2) | (gen_bound_of(data) & 0b11)), static_eval_of(data));
+
+            cluster.check[i].store(check_of(key, refreshed), std::memory_order_relaxed);
+            cluster.data[i].store(refreshed, std::memory_order_relaxed);
+        }
+
+        out.eval = eval_of(data);
+        out.depth = depth_of(data);
+        out.flag = static_cast<TTFlag>((gen_bound_of(data) & 0b11) - 1);
+        out.move = move_of(data);
+        out.static_eval = static_eval_of(data);
+
+        return true;
+    }
+
+    return false;
 }
 
-void TranspositionTable::store(uint64_t key, int eval, int depth, TTFlag flag, Move move)
+void TranspositionTable::store(uint64_t key, int eval, int depth, TTFlag flag, uint16_t move, int static_eval)
 {
-    TTEntry& entry = table[key & kIndexMask];
+    TTCluster& cluster = table[index(key)];
+
+    // snapshot the cluster; other threads may change it underneath, which only costs a worse victim
+    uint64_t datas[TTCluster::size];
+    bool same[TTCluster::size];
+
+    for(int i = 0; i < TTCluster::size; ++i)
+    {
+        datas[i] = cluster.data[i].load(std::memory_order_relaxed);
+        same[i] = cluster.check[i].load(std::memory_order_relaxed) == check_of(key, datas[i]) && gen_bound_of(datas[i]) != 0;
+    }
+
+    // same position: overwrite unless that would lose a deeper result from this search
+    int replace = -1;
+    for(int i = 0; i < TTCluster::size; ++i)
+    {
+        if(same[i])
+        {
+            if(depth < depth_of(datas[i]) && age(datas[i]) == 0 && flag != TTFlag::Exact)
+                return;
+
+            // the position's static eval doesn't change, so keep one computed earlier
+            if(static_eval == no_eval)
+                static_eval = static_eval_of(datas[i]);
 
-    if (!entry.is_valid(key) || depth >= entry.depth)
+            replace = i;
+            break;
+        }
+    }
+
+    // otherwise take an empty slot or evict the shallowest entry, counting old searches against it
+    if(replace < 0)
     {
-        entry.key = key;
-        entry.eval = eval;
-        entry.depth = depth;
-        entry.flag = flag;
-        entry.move = move;
+        replace = 0;
+
+        for(int i = 0; i < TTCluster::size; ++i)
+        {
+            if(gen_bound_of(datas[i]) == 0)
+            {
+                replace = i;
+                break;
+            }
+
+            if(depth_of(datas[i]) - age_weight * age(datas[i]) < depth_of(datas[replace]) - age_weight * age(datas[replace]))
+                replace = i;
+        }
     }
+
+    // an out of range static eval is dropped rather than clamped, since it is used as is
+    if(static_eval < -max_eval || static_eval > max_eval)
+        static_eval = no_eval;
+
+    uint64_t data = pack(move, std::clamp(eval, -max_eval, max_eval), std::clamp(depth, -128, 127), static_cast<uint8_t>((generation << 2) | (static_cast<uint8_t>(flag) + 1)), static_eval);
+
+    cluster.check[replace].store(check_of(key, data), std::memory_order_relaxed);
+    cluster.data[replace].store(data, std::memory_order_relaxed);
 }
 
-}
\ No newline at end of file
+}
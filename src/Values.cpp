@@ -0,0 +1,360 @@
+#include "nebula/Values.hpp"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace nebula
+{
+
+#if NEBULA_TUNABLE
+
+EvalParams Values::params;
+
+// one EvalParams field: where its numbers go and how many it takes
+struct ParamField
+{
+    const char* name;
+    int* ints; // int fields, one number each
+    Score* scores; // Score fields, an (mg, eg) pair or the tuner's single value each
+    int count;
+
+    // the tuner has one value per Score and phases it in itself; as eg = mg * eg_num / eg_den,
+    // that matches the engine's defaults
+    int eg_num;
+    int eg_den;
+};
+
+static std::vector<ParamField> param_fields(EvalParams& p)
+{
+    return
+    {
+        { "material_value", p.material_value, nullptr, 6, 1, 1 },
+        { "pst", &p.pst[0][0], nullptr, 6 * 64, 1, 1 },
+        { "pst_endgame", &p.pst_endgame[0][0], nullptr, 6 * 64, 1, 1 },
+
+        // castling only counts in the opening
+        { "castle_rights_bonus", nullptr, &p.castle_rights_bonus, 1, 0, 1 },
+        { "castled_position_bonus", nullptr, &p.castled_position_bonus, 1, 0, 1 },
+
+        // isolated pawns weigh 1.5 times as much in the endgame, passers 2.5 times
+        { "isolated_pawn_penalty", nullptr, &p.isolated_pawn_penalty, 1, 3, 2 },
+        { "doubled_pawn_penalty", nullptr, &p.doubled_pawn_penalty, 1, 1, 1 },
+        { "backward_pawn_penalty", nullptr, &p.backward_pawn_penalty, 1, 1, 1 },
+        { "passed_pawn_bonus", nullptr, p.passed_pawn_bonus, 8, 5, 2 },
+        { "base_values", nullptr, p.passed_pawn_bonus, 8, 5, 2 }, // the tuner's name for it
+        { "connected_passed_pawn_bonus", nullptr, &p.connected_passed_pawn_bonus, 1, 1, 1 },
+        { "protected_passed_pawn_bonus", nullptr, &p.protected_passed_pawn_bonus, 1, 1, 1 }
+    };
+}
+
+static void skip_space(const std::string& text, size_t& pos)
+{
+    while(pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])))
+        ++pos;
+}
+
+// a number or nested arrays of numbers, flattened; tuners write fractions, so values are rounded
+static bool read_numbers(const std::string& text, size_t& pos, std::vector<int>& out)
+{
+    skip_space(text, pos);
+
+    if(pos < text.size() && text[pos] == '[')
+    {
+        ++pos;
+        skip_space(text, pos);
+
+        if(pos < text.size() && text[pos] == ']')
+        {
+            ++pos;
+            return true;
+        }
+
+        while(true)
+        {
+            if(!read_numbers(text, pos, out))
+                return false;
+
+            skip_space(text, pos);
+
+            if(pos < text.size() && text[pos] == ',')
+            {
+                ++pos;
+            } else if(pos < text.size() && text[pos] == ']')
+            {
+                ++pos;
+                return true;
+            } else
+            {
+                return false;
+            }
+        }
+    }
+
+    const char* begin = text.c_str() + pos;
+    char* end = nullptr;
+    double value = std::strtod(begin, &end);
+
+    // every weight ends up in an int16_t half of a Score
+    if(end == begin || std::fabs(value) > 32767)
+        return false;
+
+    out.push_back(static_cast<int>(std::lround(value)));
+    pos += end - begin;
+
+    return true;
+}
+
+// step over any JSON value: the tuner also writes its loss history and the like
+static bool skip_value(const std::string& text, size_t& pos)
+{
+    skip_space(text, pos);
+
+    if(pos >= text.size())
+        return false;
+
+    if(text[pos] == '"')
+    {
+        for(++pos; pos < text.size() && text[pos] != '"'; ++pos)
+            if(text[pos] == '\\')
+                ++pos;
+
+        return pos++ < text.size();
+    }
+
+    if(text[pos] == '[' || text[pos] == '{')
+    {
+        std::string open;
+
+        // strings can hold brackets, so nesting is tracked outside them only
+        while(pos < text.size())
+        {
+            char c = text[pos];
+
+            if(c == '"')
+            {
+                if(!skip_value(text, pos))
+                    return false;
+
+                continue;
+            }
+
+            if(c == '[' || c == '{')
+                open += c;
+            else if(c == ']' || c == '}')
+                open.pop_back();
+
+            ++pos;
+
+            if(open.empty())
+                return true;
+        }
+
+        return false;
+    }
+
+    // numbers, true/false/null and Python's NaN
+    size_t begin = pos;
+    while(pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '-' || text[pos] == '+' || text[pos] == '.'))
+        ++pos;
+
+    return pos > begin;
+}
+
+// walk a JSON object, handing each member's name to member with pos at its value,
+// which member has to consume
+template<typename Member>
+static bool read_object(const std::string& text, size_t& pos, std::string& error, Member member)
+{
+    skip_space(text, pos);
+
+    if(pos >= text.size() || text[pos++] != '{')
+    {
+        error = "expected a JSON object at offset " + std::to_string(pos - 1);
+        return false;
+    }
+
+    // an empty object is fine too
+    skip_space(text, pos);
+    bool done = pos < text.size() && text[pos] == '}';
+    if(done)
+        ++pos;
+
+    while(!done)
+    {
+        skip_space(text, pos);
+
+        size_t close = pos < text.size() && text[pos] == '"' ? text.find('"', pos + 1) : std::string::npos;
+        if(close == std::string::npos)
+        {
+            error = "expected a quoted name at offset " + std::to_string(pos);
+            return false;
+        }
+
+        std::string name = text.substr(pos + 1, close - pos - 1);
+        pos = close + 1;
+
+        skip_space(text, pos);
+        if(pos >= text.size() || text[pos++] != ':')
+        {
+            error = "expected ':' after \"" + name + "\"";
+            return false;
+        }
+
+        if(!member(name))
+            return false;
+
+        skip_space(text, pos);
+        if(pos < text.size() && text[pos] == ',')
+        {
+            ++pos;
+        } else if(pos < text.size() && text[pos] == '}')
+        {
+            ++pos;
+            done = true;
+        } else
+        {
+            error = "expected ',' or '}' after \"" + name + "\"";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool read_param(const std::string& text, size_t& pos, const std::string& name, std::vector<ParamField>& fields, std::string& error)
+{
+    std::vector<int> numbers;
+    if(!read_numbers(text, pos, numbers))
+    {
+        error = "bad value for \"" + name + "\"";
+        return false;
+    }
+
+    // a misspelt name would otherwise be silently ignored
+    const ParamField* field = nullptr;
+    for(const ParamField& f : fields)
+        if(name == f.name)
+            field = &f;
+
+    if(!field)
+    {
+        error = "unknown parameter \"" + name + "\"";
+        return false;
+    }
+
+    int got = static_cast<int>(numbers.size());
+
+    if(field->ints)
+    {
+        if(got != field->count)
+        {
+            error = "\"" + name + "\" needs " + std::to_string(field->count) + " numbers, got " + std::to_string(got);
+            return false;
+        }
+
+        for(int i = 0; i < field->count; ++i)
+            field->ints[i] = numbers[i];
+
+        return true;
+    }
+
+    if(got != field->count && got != field->count * 2)
+    {
+        error = "\"" + name + "\" needs " + std::to_string(field->count) + " numbers or " + std::to_string(field->count * 2)
+            + " as [mg, eg] pairs, got " + std::to_string(got);
+        return false;
+    }
+
+    for(int i = 0; i < field->count; ++i)
+    {
+        int mg = got == field->count ? numbers[i] : numbers[2 * i];
+        int eg = got == field->count ? mg * field->eg_num / field->eg_den : numbers[2 * i + 1];
+
+        if(std::abs(eg) > 32767)
+        {
+            error = "\"" + name + "\" is out of range in the endgame";
+            return false;
+        }
+
+        field->scores[i] = Score(mg, eg);
+    }
+
+    return true;
+}
+
+bool Values::load(const std::string& path, std::string& error)
+{
+    std::ifstream in(path);
+    if(!in)
+    {
+        error = "could not open " + path;
+        return false;
+    }
+
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    const std::string text = buffer.str();
+
+    // fill a copy, so a bad file leaves the current values alone
+    EvalParams parsed = params;
+    std::vector<ParamField> fields = param_fields(parsed);
+
+    size_t pos = 0;
+    bool nested = false, found = false;
+
+    // tune_evaluation.py writes { "gradient_descent": { "final_params": {...}, "history": {...} } };
+    // anything else at the top level is taken as the parameters themselves
+    bool ok = read_object(text, pos, error, [&](const std::string& name)
+    {
+        if(name != "gradient_descent")
+            return read_param(text, pos, name, fields, error);
+
+        nested = true;
+
+        return read_object(text, pos, error, [&](const std::string& inner)
+        {
+            if(inner != "final_params")
+            {
+                if(!skip_value(text, pos))
+                {
+                    error = "bad value for \"" + inner + "\"";
+                    return false;
+                }
+
+                return true;
+            }
+
+            found = true;
+            return read_object(text, pos, error, [&](const std::string& field) { return read_param(text, pos, field, fields, error); });
+        });
+    });
+
+    if(!ok)
+        return false;
+
+    if(nested && !found)
+    {
+        error = "no \"final_params\" under \"gradient_descent\"";
+        return false;
+    }
+
+    params = parsed;
+
+    return true;
+}
+
+#else
+
+bool Values::load(const std::string&, std::string& error)
+{
+    error = "built without NEBULA_TUNABLE=1; parameters are compiled in";
+    return false;
+}
+
+#endif
+
+}
@@ -1,34 +1,88 @@
 #include "nebula/Board.hpp"
 #include "nebula/CLIHelper.hpp"
 #include "nebula/Driver.hpp"
+#include "nebula/NNUE.hpp"
+#include "nebula/Perft.hpp"
+#include "nebula/Search.hpp"
+#include "nebula/Values.hpp"
 
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <stdexcept>
 
 int main(int argc, char* argv[])
 {
     std::cout << std::fixed << std::setprecision(2);
 
     // input
-    nebula::InputMode mode;
-    int depth = 8;
-    int max_moves = std::numeric_limits<int>::max();
+    nebula::Options options;
 
-    switch(nebula::opts(argc, argv, mode, depth, max_moves))
+    switch(nebula::opts(argc, argv, options))
     {
         case nebula::ReturnCode::Good:
         {
+            // perft suites bring their own positions
+            if(options.mode == nebula::InputMode::Perft && !options.epd.empty())
+                return nebula::perft_suite(options.epd, options.depth, options.threads, options.perft_hash_mb) == 0 ? 0 : 1;
+
+            // both before any board exists: boards keep PST sums and accumulators from the start
+            if(!options.params_file.empty())
+            {
+                std::string error;
+                if(!nebula::Values::load(options.params_file, error))
+                {
+                    std::cerr << "Could not load parameters: " << error << '\n';
+                    return 1;
+                }
+            }
+
+            if(options.eval == nebula::EvalMode::NNUE && !nebula::NNUE::load(options.nnue_file))
+            {
+                std::cerr << "Could not load network: " << options.nnue_file << '\n';
+                return 1;
+            }
+
             nebula::Board board;
 
-            switch(mode)
+            try
+            {
+                if(!options.fen.empty())
+                    board = nebula::Board(options.fen);
+            } catch(const std::invalid_argument& e)
+            {
+                std::cerr << e.what() << '\n';
+                return 1;
+            }
+
+            nebula::SearchLimits limits;
+            limits.movetime = options.movetime;
+            limits.time[static_cast<int>(nebula::Color::White)] = options.wtime;
+            limits.time[static_cast<int>(nebula::Color::Black)] = options.btime;
+            limits.inc[static_cast<int>(nebula::Color::White)] = options.winc;
+            limits.inc[static_cast<int>(nebula::Color::Black)] = options.binc;
+            limits.nodes = options.nodes;
+
+            // time and node limits decide when to stop unless a depth is given
+            bool limited = options.movetime > 0 || options.wtime > 0 || options.btime > 0 || options.nodes > 0;
+            int depth = options.depth > 0 ? options.depth : (limited ? nebula::Search::max_ply : 8);
+
+            switch(options.mode)
             {
                 case nebula::InputMode::PlayerInput:
-                    nebula::pve(board, depth, max_moves);
+                    nebula::pve(board, depth, options.length, options.threads, limits, options.hash_mb, options.hash_file);
                     break;
                 
                 case nebula::InputMode::Auto:
-                    nebula::eve(board, depth, max_moves);
+                    nebula::eve(board, depth, options.length, options.threads, limits, options.hash_mb, options.hash_file);
+                    break;
+
+                case nebula::InputMode::Perft:
+                    nebula::perft(board, options.depth > 0 ? options.depth : 5, options.divide, options.threads, options.perft_hash_mb);
+                    break;
+
+                case nebula::InputMode::Bench:
+                    nebula::bench(options.depth > 0 ? options.depth : 8, options.threads, options.hash_mb, options.baseline_nps);
                     break;
             }
 
@@ -45,4 +99,4 @@ int main(int argc, char* argv[])
     }
     
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,101 @@
+// Values::load against tune_evaluation.py's own output; run from the repository root:
+//
+//   g++ -std=c++17 -DNEBULA_TUNABLE=1 -Iinclude src/Values.cpp tests/ValuesLoad.cpp -o values_load && ./values_load
+//
+// tests/data/tuning_results.json is what the tuner wrote for tuning/data, with its history cut to
+// the first three epochs. Its final_params are still the tuner's starting values, which are the
+// engine's defaults, so loading it has to give back exactly EvalParams{}
+
+#include "nebula/Values.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+using nebula::EvalParams;
+using nebula::Score;
+using nebula::Values;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+    if(!ok)
+    {
+        std::printf("FAIL: %s\n", what);
+        ++failures;
+    }
+}
+
+static bool same(const EvalParams& a, const EvalParams& b)
+{
+    bool ok = std::memcmp(a.material_value, b.material_value, sizeof(a.material_value)) == 0
+        && std::memcmp(a.pst, b.pst, sizeof(a.pst)) == 0
+        && std::memcmp(a.pst_endgame, b.pst_endgame, sizeof(a.pst_endgame)) == 0
+        && a.castle_rights_bonus == b.castle_rights_bonus
+        && a.castled_position_bonus == b.castled_position_bonus
+        && a.isolated_pawn_penalty == b.isolated_pawn_penalty
+        && a.doubled_pawn_penalty == b.doubled_pawn_penalty
+        && a.backward_pawn_penalty == b.backward_pawn_penalty
+        && a.connected_passed_pawn_bonus == b.connected_passed_pawn_bonus
+        && a.protected_passed_pawn_bonus == b.protected_passed_pawn_bonus;
+
+    for(int i = 0; i < 8; ++i)
+        ok = ok && a.passed_pawn_bonus[i] == b.passed_pawn_bonus[i];
+
+    return ok;
+}
+
+static bool load(const std::string& path)
+{
+    std::string error;
+    bool ok = Values::load(path, error);
+
+    if(!ok)
+        std::printf("%s: %s\n", path.c_str(), error.c_str());
+
+    return ok;
+}
+
+static std::string write(const std::string& text)
+{
+    const std::string path = "values_load.json";
+    std::ofstream(path) << text;
+
+    return path;
+}
+
+int main()
+{
+    const EvalParams defaults{};
+
+    // start away from the defaults, so the file has to put them back
+    check(load(write("{ \"gradient_descent\": { \"final_params\": { \"castle_rights_bonus\": 1, \"base_values\": [1, 1, 1, 1, 1, 1, 1, 1] } } }")), "load a modified file");
+    check(!same(Values::params, defaults), "modified file changes the parameters");
+
+    check(load("tests/data/tuning_results.json"), "load the tuner's results file");
+    check(same(Values::params, defaults), "tuner's starting values map onto EvalParams{}");
+
+    // single values are phased the way the tuner phases them
+    check(load(write("{ \"gradient_descent\": { \"history\": { \"loss\": [NaN, 2.5] }, \"final_params\": {"
+                     " \"castle_rights_bonus\": 40.4, \"isolated_pawn_penalty\": 31.0, \"doubled_pawn_penalty\": -12.0,"
+                     " \"base_values\": [0.0, 12.0, 20.0, 40.0, 80.0, 150.0, 300.0, 0.0] } } }")), "load tuned values");
+    check(Values::params.castle_rights_bonus == Score(40, 0), "castling only counts in the opening");
+    check(Values::params.isolated_pawn_penalty == Score(31, 46), "isolated pawns weigh 1.5 times in the endgame");
+    check(Values::params.doubled_pawn_penalty == Score(-12, -12), "negative values load as is");
+    check(Values::params.passed_pawn_bonus[1] == Score(12, 30) && Values::params.passed_pawn_bonus[6] == Score(300, 750), "passers weigh 2.5 times in the endgame");
+
+    // a rejected file changes nothing
+    const EvalParams before = Values::params;
+    std::string error;
+    check(!Values::load(write("{ \"gradient_descent\": { \"final_params\": { \"castle_rights_bonus\": 50, \"base_values\": [1, 2] } } }"), error), "reject a short base_values");
+    check(!Values::load(write("{ \"gradient_descent\": { \"history\": {} } }"), error), "reject a results file without final_params");
+    check(same(Values::params, before), "rejected files leave the parameters alone");
+
+    std::remove("values_load.json");
+
+    std::printf(failures ? "%d failed\n" : "ok\n", failures);
+
+    return failures ? 1 : 0;
+}